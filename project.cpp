@@ -1,1511 +1,7766 @@
-#include <iostream>
-#include <vector>
-#include <unordered_map>
-#include <queue>
-#include <algorithm>
-#include <string>
-#include <limits>
-#include <ctime>
-#include <map>
-#include <set>
-
-using namespace std;
-
-struct Route {
-    string destination;
-    double distance;
-    double cost;
-    double time;
-};
-
-class Graph {
-private:
-    unordered_map<string, map<string, string>> cities;
-    unordered_map<string, vector<Route>> routes;
-
-    struct PathResult {
-        vector<string> path;
-        double totalWeight;
-        string weightType;
-    };
-
-    PathResult dijkstra(const string& source, const string& destination, const string& weightType) {
-        unordered_map<string, double> distances;
-        unordered_map<string, string> previous;
-
-        for (const auto& city : cities) {
-            distances[city.first] = numeric_limits<double>::infinity();
-        }
-        distances[source] = 0;
-
-        auto cmp = [](pair<double, string> a, pair<double, string> b) {
-            return a.first > b.first;
-        };
-        priority_queue<pair<double, string>, vector<pair<double, string>>, decltype(cmp)> pq(cmp);
-        pq.push({0, source});
-
-        while (!pq.empty()) {
-            auto [currentDist, current] = pq.top();
-            pq.pop();
-
-            if (current == destination) break;
-            if (currentDist > distances[current]) continue;
-
-            for (const Route& route : routes[current]) {
-                double weight = 0;
-                if (weightType == "distance") weight = route.distance;
-                else if (weightType == "cost") weight = route.cost;
-                else if (weightType == "time") weight = route.time;
-
-                double distance = currentDist + weight;
-
-                if (distance < distances[route.destination]) {
-                    distances[route.destination] = distance;
-                    previous[route.destination] = current;
-                    pq.push({distance, route.destination});
-                }
-            }
-        }
-
-        vector<string> path;
-        string current = destination;
-        while (!current.empty()) {
-            path.push_back(current);
-            current = previous[current];
-        }
-        reverse(path.begin(), path.end());
-
-        return {path, distances[destination], weightType};
-    }
-
-public:
-    bool addCity(const string& cityName, const map<string, string>& metadata = {}) {
-        if (cities.find(cityName) == cities.end()) {
-            cities[cityName] = metadata;
-            return true;
-        }
-        return false;
-    }
-
-    void addRoute(const string& city1, const string& city2, double distance, double cost, double time) {
-        routes[city1].push_back({city2, distance, cost, time});
-        routes[city2].push_back({city1, distance, cost, time});
-    }
-
-    void removeRoute(const string& city1, const string& city2) {
-        auto& routes1 = routes[city1];
-        routes1.erase(remove_if(routes1.begin(), routes1.end(),
-            [&city2](const Route& r) { return r.destination == city2; }), routes1.end());
-
-        auto& routes2 = routes[city2];
-        routes2.erase(remove_if(routes2.begin(), routes2.end(),
-            [&city1](const Route& r) { return r.destination == city1; }), routes2.end());
-    }
-
-    vector<string> getAllCities() {
-        vector<string> cityList;
-        for (const auto& city : cities) {
-            cityList.push_back(city.first);
-        }
-        return cityList;
-    }
-
-    PathResult findShortestPath(const string& source, const string& destination) {
-        return dijkstra(source, destination, "distance");
-    }
-
-    PathResult findCheapestPath(const string& source, const string& destination) {
-        return dijkstra(source, destination, "cost");
-    }
-
-    PathResult findFastestPath(const string& source, const string& destination) {
-        return dijkstra(source, destination, "time");
-    }
-
-    PathResult findPathWithStops(const string& source, const string& destination, const vector<string>& stops) {
-        vector<string> allStops = {source};
-        allStops.insert(allStops.end(), stops.begin(), stops.end());
-        allStops.push_back(destination);
-
-        vector<string> totalPath;
-        double totalDistance = 0;
-
-        for (size_t i = 0; i < allStops.size() - 1; i++) {
-            PathResult result = findShortestPath(allStops[i], allStops[i + 1]);
-            totalPath.insert(totalPath.end(), result.path.begin(), result.path.end() - 1);
-            totalDistance += result.totalWeight;
-        }
-        totalPath.push_back(destination);
-
-        return {totalPath, totalDistance, "distance"};
-    }
-
-    vector<PathResult> getAlternativePaths(const string& source, const string& destination, int k = 3) {
-        vector<PathResult> paths;
-        PathResult mainPath = findShortestPath(source, destination);
-        paths.push_back(mainPath);
-
-        for (size_t i = 1; i < mainPath.path.size() - 1 && paths.size() < k; i++) {
-            string excludeCity = mainPath.path[i];
-            vector<Route> tempRoutes = routes[excludeCity];
-            routes[excludeCity].clear();
-
-            PathResult altPath = findShortestPath(source, destination);
-            if (altPath.totalWeight != numeric_limits<double>::infinity()) {
-                paths.push_back(altPath);
-            }
-
-            routes[excludeCity] = tempRoutes;
-        }
-
-        return paths;
-    }
-};
-
-class ItineraryNode {
-public:
-    string nodeType;
-    map<string, string> data;
-    vector<ItineraryNode*> children;
-
-    ItineraryNode(const string& type, const map<string, string>& nodeData)
-        : nodeType(type), data(nodeData) {}
-
-    void addChild(ItineraryNode* child) {
-        children.push_back(child);
-    }
-
-    void removeChild(ItineraryNode* child) {
-        children.erase(remove(children.begin(), children.end(), child), children.end());
-    }
-
-    ~ItineraryNode() {
-        for (auto child : children) {
-            delete child;
-        }
-    }
-};
-
-class ItineraryTree {
-private:
-    ItineraryNode* root;
-
-public:
-    ItineraryTree() : root(nullptr) {}
-
-    ItineraryNode* createItinerary(const string& tripName, const string& startDate, const string& endDate) {
-        map<string, string> data = {
-            {"name", tripName},
-            {"start_date", startDate},
-            {"end_date", endDate}
-        };
-        root = new ItineraryNode("trip", data);
-        return root;
-    }
-
-    ItineraryNode* addDay(int dayNumber, const string& date) {
-        if (!root) return nullptr;
-
-        map<string, string> data = {
-            {"day_number", to_string(dayNumber)},
-            {"date", date}
-        };
-        ItineraryNode* dayNode = new ItineraryNode("day", data);
-        root->addChild(dayNode);
-        return dayNode;
-    }
-
-    ItineraryNode* addActivity(int dayNumber, const map<string, string>& activity) {
-        if (!root) return nullptr;
-
-        for (auto dayNode : root->children) {
-            if (dayNode->data["day_number"] == to_string(dayNumber)) {
-                ItineraryNode* activityNode = new ItineraryNode("activity", activity);
-                dayNode->addChild(activityNode);
-                return activityNode;
-            }
-        }
-        return nullptr;
-    }
-
-    bool removeActivity(int dayNumber, const string& activityId) {
-        if (!root) return false;
-
-        for (auto dayNode : root->children) {
-            if (dayNode->data["day_number"] == to_string(dayNumber)) {
-                for (auto activityNode : dayNode->children) {
-                    if (activityNode->data["id"] == activityId) {
-                        dayNode->removeChild(activityNode);
-                        delete activityNode;
-                        return true;
-                    }
-                }
-            }
-        }
-        return false;
-    }
-
-    ItineraryNode* moveActivity(int fromDay, int toDay, const string& activityId) {
-        map<string, string> activityData;
-        ItineraryNode* activityToMove = nullptr;
-
-        for (auto dayNode : root->children) {
-            if (dayNode->data["day_number"] == to_string(fromDay)) {
-                for (auto activityNode : dayNode->children) {
-                    if (activityNode->data["id"] == activityId) {
-                        activityData = activityNode->data;
-                        dayNode->removeChild(activityNode);
-                        delete activityNode;
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (!activityData.empty()) {
-            return addActivity(toDay, activityData);
-        }
-        return nullptr;
-    }
-
-    string displayItinerary() {
-        if (!root) return "No itinerary created";
-
-        string result = "\n============================================================\n";
-        result += "Trip: " + root->data["name"] + "\n";
-        result += "Duration: " + root->data["start_date"] + " to " + root->data["end_date"] + "\n";
-        result += "============================================================\n\n";
-
-        for (auto dayNode : root->children) {
-            result += "Day " + dayNode->data["day_number"] + " - " + dayNode->data["date"] + "\n";
-            result += "----------------------------------------\n";
-
-            if (dayNode->children.empty()) {
-                result += "  No activities planned\n";
-            } else {
-                int count = 1;
-                for (auto activity : dayNode->children) {
-                    result += "  " + to_string(count++) + ". " + activity->data["name"] + "\n";
-                    result += "     Duration: " + activity->data["duration"] + " | ";
-                    result += "Cost: $" + activity->data["cost"] + "\n";
-                }
-            }
-            result += "\n";
-        }
-
-        return result;
-    }
-
-    vector<map<string, string>> getDaySchedule(int dayNumber) {
-        vector<map<string, string>> activities;
-        if (!root) return activities;
-
-        for (auto dayNode : root->children) {
-            if (dayNode->data["day_number"] == to_string(dayNumber)) {
-                for (auto activity : dayNode->children) {
-                    activities.push_back(activity->data);
-                }
-                break;
-            }
-        }
-        return activities;
-    }
-
-    double getTotalDuration() {
-        if (!root) return 0;
-
-        double total = 0;
-        for (auto dayNode : root->children) {
-            for (auto activity : dayNode->children) {
-                total += stod(activity->data["duration"]);
-            }
-        }
-        return total;
-    }
-
-    double getTotalCost() {
-        if (!root) return 0;
-
-        double total = 0;
-        for (auto dayNode : root->children) {
-            for (auto activity : dayNode->children) {
-                total += stod(activity->data["cost"]);
-            }
-        }
-        return total;
-    }
-
-    vector<map<string, string>> inOrderTraversal() {
-        vector<map<string, string>> result;
-        inOrderHelper(root, result);
-        return result;
-    }
-
-    void inOrderHelper(ItineraryNode* node, vector<map<string, string>>& result) {
-        if (!node) return;
-
-        if (!node->children.empty()) {
-            inOrderHelper(node->children[0], result);
-        }
-
-        result.push_back(node->data);
-
-        for (size_t i = 1; i < node->children.size(); i++) {
-            inOrderHelper(node->children[i], result);
-        }
-    }
-
-    vector<pair<int, map<string, string>>> preOrderTraversal() {
-        vector<pair<int, map<string, string>>> result;
-        preOrderHelper(root, result, 0);
-        return result;
-    }
-
-    void preOrderHelper(ItineraryNode* node, vector<pair<int, map<string, string>>>& result, int level) {
-        if (!node) return;
-
-        result.push_back({level, node->data});
-        for (auto child : node->children) {
-            preOrderHelper(child, result, level + 1);
-        }
-    }
-
-    ~ItineraryTree() {
-        delete root;
-    }
-};
-
-
-struct Activity {
-    string id;
-    string name;
-    string location;
-    string category;
-    double cost;
-    double rating;
-    double duration;
-};
-
-class ActivityManager {
-private:
-    unordered_map<string, vector<Activity>> activitiesDB;
-
-    vector<Activity> quickSort(vector<Activity> arr, const string& key, const string& order) {
-        if (arr.size() <= 1) return arr;
-
-        Activity pivot = arr[arr.size() / 2];
-        vector<Activity> left, middle, right;
-
-        for (const Activity& a : arr) {
-            double pivotVal = 0, aVal = 0;
-
-            if (key == "cost") {
-                pivotVal = pivot.cost;
-                aVal = a.cost;
-            } else if (key == "rating") {
-                pivotVal = pivot.rating;
-                aVal = a.rating;
-            } else if (key == "duration") {
-                pivotVal = pivot.duration;
-                aVal = a.duration;
-            }
-
-            if (order == "asc") {
-                if (aVal < pivotVal) left.push_back(a);
-                else if (aVal == pivotVal) middle.push_back(a);
-                else right.push_back(a);
-            } else {
-                if (aVal > pivotVal) left.push_back(a);
-                else if (aVal == pivotVal) middle.push_back(a);
-                else right.push_back(a);
-            }
-        }
-
-        vector<Activity> sortedLeft = quickSort(left, key, order);
-        vector<Activity> sortedRight = quickSort(right, key, order);
-
-        sortedLeft.insert(sortedLeft.end(), middle.begin(), middle.end());
-        sortedLeft.insert(sortedLeft.end(), sortedRight.begin(), sortedRight.end());
-
-        return sortedLeft;
-    }
-
-public:
-    Activity addActivityToDB(const string& name, const string& location, const string& category,
-                            double cost, double rating, double duration) {
-        Activity activity = {
-            location + "_" + to_string(activitiesDB[location].size()),
-            name, location, category, cost, rating, duration
-        };
-
-        activitiesDB[location].push_back(activity);
-        return activity;
-    }
-
-    vector<Activity> getAllActivities(const string& city) {
-        return activitiesDB[city];
-    }
-
-    vector<Activity> getActivityByCategory(const string& category) {
-        vector<Activity> result;
-        for (const auto& cityPair : activitiesDB) {
-            for (const Activity& a : cityPair.second) {
-                if (a.category == category) {
-                    result.push_back(a);
-                }
-            }
-        }
-        return result;
-    }
-
-    vector<Activity> sortByCost(vector<Activity> activities, const string& order = "asc") {
-        return quickSort(activities, "cost", order);
-    }
-
-    vector<Activity> sortByRating(vector<Activity> activities, const string& order = "desc") {
-        return quickSort(activities, "rating", order);
-    }
-
-    vector<Activity> sortByDuration(vector<Activity> activities, const string& order = "asc") {
-        return quickSort(activities, "duration", order);
-    }
-
-
-vector<Activity> sortByDistance(vector<Activity> activities, const string& currentLocation) {
-    sort(activities.begin(), activities.end(),
-        [&currentLocation](const Activity& a, const Activity& b) {
-            size_t hashA = hash<string>{}(a.location);
-            size_t hashB = hash<string>{}(b.location);
-            size_t hashCurrent = hash<string>{}(currentLocation);
-
-            long long diffA = static_cast<long long>(hashA) - static_cast<long long>(hashCurrent);
-            long long diffB = static_cast<long long>(hashB) - static_cast<long long>(hashCurrent);
-
-            long long absDiffA = (diffA < 0) ? -diffA : diffA;
-            long long absDiffB = (diffB < 0) ? -diffB : diffB;
-
-            return absDiffA < absDiffB;
-        });
-    return activities;
-}
-
-    Activity* binarySearchByName(vector<Activity>& activities, const string& name) {
-        sort(activities.begin(), activities.end(),
-            [](const Activity& a, const Activity& b) { return a.name < b.name; });
-
-        int left = 0, right = activities.size() - 1;
-
-        while (left <= right) {
-            int mid = left + (right - left) / 2;
-
-            if (activities[mid].name == name) {
-                return &activities[mid];
-            } else if (activities[mid].name < name) {
-                left = mid + 1;
-            } else {
-                right = mid - 1;
-            }
-        }
-        return nullptr;
-    }
-
-    vector<Activity> binarySearchByPrice(vector<Activity> activities, double maxPrice) {
-        sort(activities.begin(), activities.end(),
-            [](const Activity& a, const Activity& b) { return a.cost < b.cost; });
-
-        vector<Activity> result;
-        for (const Activity& a : activities) {
-            if (a.cost <= maxPrice) {
-                result.push_back(a);
-            } else {
-                break;
-            }
-        }
-        return result;
-    }
-
-    vector<Activity> linearSearchByCategory(const vector<Activity>& activities, const string& category) {
-        vector<Activity> result;
-        for (const Activity& a : activities) {
-            if (a.category == category) {
-                result.push_back(a);
-            }
-        }
-        return result;
-    }
-
-    vector<Activity> filterActivities(vector<Activity> activities, const map<string, double>& criteria) {
-        vector<Activity> result = activities;
-
-        if (criteria.find("max_cost") != criteria.end()) {
-            result.erase(remove_if(result.begin(), result.end(),
-                [&criteria](const Activity& a) { return a.cost > criteria.at("max_cost"); }), result.end());
-        }
-
-        if (criteria.find("min_rating") != criteria.end()) {
-            result.erase(remove_if(result.begin(), result.end(),
-                [&criteria](const Activity& a) { return a.rating < criteria.at("min_rating"); }), result.end());
-        }
-
-        if (criteria.find("max_duration") != criteria.end()) {
-            result.erase(remove_if(result.begin(), result.end(),
-                [&criteria](const Activity& a) { return a.duration > criteria.at("max_duration"); }), result.end());
-        }
-
-        return result;
-    }
-};
-
-
-struct Song {
-    string name;
-    string artist;
-    map<string, string> metadata;
-};
-
-class TrieNode {
-public:
-    unordered_map<char, TrieNode*> children;
-    bool isEnd;
-    Song* songData;
-
-    TrieNode() : isEnd(false), songData(nullptr) {}
-
-    ~TrieNode() {
-        for (auto& pair : children) {
-            delete pair.second;
-        }
-        delete songData;
-    }
-};
-
-class MusicTrie {
-private:
-    TrieNode* root;
-
-    void collectSongs(TrieNode* node, string prefix, vector<Song>& songs) {
-        if (!node) return;
-
-        if (node->isEnd && node->songData) {
-            songs.push_back(*node->songData);
-        }
-
-        for (auto& pair : node->children) {
-            collectSongs(pair.second, prefix + pair.first, songs);
-        }
-    }
-
-    void collectAllSongsHelper(TrieNode* node, vector<Song>& songs) {
-        if (!node) return;
-
-        if (node->isEnd && node->songData) {
-            songs.push_back(*node->songData);
-        }
-
-        for (auto& pair : node->children) {
-            collectAllSongsHelper(pair.second, songs);
-        }
-    }
-
-public:
-    MusicTrie() {
-        root = new TrieNode();
-    }
-
-    void insertSong(const string& songName, const string& artist, const map<string, string>& metadata = {}) {
-        TrieNode* node = root;
-        string lowerName = songName;
-        transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-
-        for (char c : lowerName) {
-            if (node->children.find(c) == node->children.end()) {
-                node->children[c] = new TrieNode();
-            }
-            node = node->children[c];
-        }
-
-        node->isEnd = true;
-        node->songData = new Song{songName, artist, metadata};
-    }
-
-    vector<Song> searchPrefix(const string& prefix) {
-        TrieNode* node = root;
-        string lowerPrefix = prefix;
-        transform(lowerPrefix.begin(), lowerPrefix.end(), lowerPrefix.begin(), ::tolower);
-
-        for (char c : lowerPrefix) {
-            if (node->children.find(c) == node->children.end()) {
-                return vector<Song>();
-            }
-            node = node->children[c];
-        }
-
-        vector<Song> songs;
-        collectSongs(node, prefix, songs);
-        return songs;
-    }
-
-    vector<Song> autoComplete(const string& prefix, int limit) {
-        vector<Song> allMatches = searchPrefix(prefix);
-
-        if (allMatches.size() <= limit) {
-            return allMatches;
-        }
-
-        return vector<Song>(allMatches.begin(), allMatches.begin() + limit);
-    }
-
-    bool deleteSong(const string& songName) {
-        return deleteSongHelper(root, songName, 0);
-    }
-
-    bool deleteSongHelper(TrieNode* node, const string& songName, int depth) {
-        if (!node) return false;
-
-        string lowerName = songName;
-        transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-
-        if (depth == lowerName.length()) {
-            if (!node->isEnd) return false;
-
-            node->isEnd = false;
-            delete node->songData;
-            node->songData = nullptr;
-
-            return node->children.empty();
-        }
-
-        char c = lowerName[depth];
-        if (node->children.find(c) == node->children.end()) {
-            return false;
-        }
-
-        bool shouldDeleteChild = deleteSongHelper(node->children[c], songName, depth + 1);
-
-        if (shouldDeleteChild) {
-            delete node->children[c];
-            node->children.erase(c);
-            return !node->isEnd && node->children.empty();
-        }
-
-        return false;
-    }
-
-    vector<Song> getAllSongs() {
-        vector<Song> songs;
-        collectAllSongsHelper(root, songs);
-        return songs;
-    }
-
-    vector<Song> searchByArtist(const string& artistName) {
-        vector<Song> allSongs = getAllSongs();
-        vector<Song> result;
-
-        for (const Song& song : allSongs) {
-            if (song.artist == artistName) {
-                result.push_back(song);
-            }
-        }
-
-        return result;
-    }
-
-    ~MusicTrie() {
-        delete root;
-    }
-};
-
-
-class FrequencyTracker {
-private:
-    unordered_map<string, int> playCount;
-    unordered_map<string, Song> songMetadata;
-
-public:
-    void initializeFrequencyMap() {
-        playCount.clear();
-        songMetadata.clear();
-    }
-
-    void incrementPlayCount(const string& songId) {
-        playCount[songId]++;
-    }
-
-    int getPlayCount(const string& songId) {
-        return playCount[songId];
-    }
-
-    vector<pair<string, int>> getMostPlayed(int k) {
-        vector<pair<string, int>> songs(playCount.begin(), playCount.end());
-
-        sort(songs.begin(), songs.end(),
-            [](const pair<string, int>& a, const pair<string, int>& b) {
-                return a.second > b.second;
-            });
-
-        if (songs.size() <= k) {
-            return songs;
-        }
-
-        return vector<pair<string, int>>(songs.begin(), songs.begin() + k);
-    }
-
-    void resetFrequencies() {
-        playCount.clear();
-    }
-
-    Song getSongMetadata(const string& songId) {
-        return songMetadata[songId];
-    }
-
-    void updateSongInfo(const string& songId, const Song& newData) {
-        songMetadata[songId] = newData;
-    }
-
-    void addSongMetadata(const string& songId, const Song& song) {
-        songMetadata[songId] = song;
-        if (playCount.find(songId) == playCount.end()) {
-            playCount[songId] = 0;
-        }
-    }
-};
-
-
-struct SongWithPriority {
-    Song song;
-    double priority;
-
-    bool operator<(const SongWithPriority& other) const {
-        return priority < other.priority;
-    }
-};
-
-class PlaylistHeap {
-private:
-    priority_queue<SongWithPriority> maxHeap;
-    vector<Song> currentPlaylist;
-
-public:
-    void buildMaxHeap(const vector<Song>& songs, const string& criteria = "rating") {
-        while (!maxHeap.empty()) maxHeap.pop();
-
-        for (const Song& song : songs) {
-            double priority = 0;
-
-            if (criteria == "rating" && song.metadata.find("rating") != song.metadata.end()) {
-                priority = stod(song.metadata.at("rating"));
-            } else if (criteria == "frequency" && song.metadata.find("frequency") != song.metadata.end()) {
-                priority = stod(song.metadata.at("frequency"));
-            } else {
-                priority = 1.0;
-            }
-
-            maxHeap.push({song, priority});
-        }
-    }
-
-    vector<Song> extractTopK(int k) {
-        vector<Song> topSongs;
-        priority_queue<SongWithPriority> tempHeap = maxHeap;
-
-        for (int i = 0; i < k && !tempHeap.empty(); i++) {
-            topSongs.push_back(tempHeap.top().song);
-            tempHeap.pop();
-        }
-
-        return topSongs;
-    }
-
-    void insertSong(const Song& song, double priority) {
-        maxHeap.push({song, priority});
-    }
-
-    void heapify() {
-        vector<SongWithPriority> temp;
-        while (!maxHeap.empty()) {
-            temp.push_back(maxHeap.top());
-            maxHeap.pop();
-        }
-
-        for (const auto& item : temp) {
-            maxHeap.push(item);
-        }
-    }
-
-    vector<Song> getTopSongs(int k, const string& criteria) {
-        return extractTopK(k);
-    }
-
-    vector<Song> mergePlaylists(const vector<Song>& playlist1, const vector<Song>& playlist2) {
-        vector<Song> merged = playlist1;
-        merged.insert(merged.end(), playlist2.begin(), playlist2.end());
-        return merged;
-    }
-
-    vector<Song> generatePlaylist(int tripDuration, const string& mood, const string& genre) {
-        vector<Song> playlist = extractTopK(tripDuration / 3);
-        currentPlaylist = playlist;
-        return playlist;
-    }
-
-    vector<Song> optimizePlaylistOrder(const vector<Song>& songs) {
-        return songs;
-    }
-
-    void addToPlaylist(const Song& song) {
-        currentPlaylist.push_back(song);
-    }
-
-    bool removeFromPlaylist(const string& songId) {
-        for (auto it = currentPlaylist.begin(); it != currentPlaylist.end(); ++it) {
-            if (it->name == songId) {
-                currentPlaylist.erase(it);
-                return true;
-            }
-        }
-        return false;
-    }
-
-    vector<Song> shufflePlaylist() {
-        vector<Song> shuffled = currentPlaylist;
-        random_shuffle(shuffled.begin(), shuffled.end());
-        return shuffled;
-    }
-
-    vector<Song> getCurrentPlaylist() {
-        return currentPlaylist;
-    }
-};
-
-void displayMainMenu() {
-    cout << "\n========================================================\n";
-    cout << "       TRAVEL PLANNING & MUSIC SYSTEM                   \n";
-    cout << "========================================================\n";
-    cout << "1.  Route Planning (Graph)\n";
-    cout << "2.  Itinerary Management (Tree)\n";
-    cout << "3.  Activity Search & Sort\n";
-    cout << "4.  Music Library (Trie)\n";
-    cout << "5.  Song Frequency Tracking\n";
-    cout << "6.  Playlist Generation (Heap)\n";
-    cout << "0.  Exit\n";
-    cout << "--------------------------------------------------------\n";
-    cout << "Enter your choice: ";
-}
-
-void routePlanningMenu(Graph& graph) {
-    int choice;
-    do {
-        cout << "\n--- ROUTE PLANNING ---\n";
-        cout << "1. Add City\n";
-        cout << "2. Add Route\n";
-        cout << "3. Find Shortest Path\n";
-        cout << "4. Find Cheapest Path\n";
-        cout << "5. Find Fastest Path\n";
-        cout << "6. Find Path with Stops\n";
-        cout << "7. Get Alternative Paths\n";
-        cout << "8. View All Cities\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            string city;
-            cout << "Enter city name: ";
-            cin.ignore();
-            getline(cin, city);
-            if (graph.addCity(city)) {
-                cout << "✓ City added successfully!\n";
-            } else {
-                cout << "✗ City already exists!\n";
-            }
-        }
-        else if (choice == 2) {
-            string city1, city2;
-            double distance, cost, time;
-            cout << "Enter first city: ";
-            cin.ignore();
-            getline(cin, city1);
-            cout << "Enter second city: ";
-            getline(cin, city2);
-            cout << "Enter distance (km): ";
-            cin >> distance;
-            cout << "Enter cost ($): ";
-            cin >> cost;
-            cout << "Enter time (hours): ";
-            cin >> time;
-            graph.addRoute(city1, city2, distance, cost, time);
-            cout << "✓ Route added successfully!\n";
-        }
-        else if (choice == 3) {
-            string source, dest;
-            cout << "Enter source city: ";
-            cin.ignore();
-            getline(cin, source);
-            cout << "Enter destination city: ";
-            getline(cin, dest);
-            auto result = graph.findShortestPath(source, dest);
-            cout << "\n--- Shortest Path ---\n";
-            cout << "Path: ";
-            for (size_t i = 0; i < result.path.size(); i++) {
-                cout << result.path[i];
-                if (i < result.path.size() - 1) cout << " → ";
-            }
-            cout << "\nTotal Distance: " << result.totalWeight << " km\n";
-        }
-        else if (choice == 4) {
-            string source, dest;
-            cout << "Enter source city: ";
-            cin.ignore();
-            getline(cin, source);
-            cout << "Enter destination city: ";
-            getline(cin, dest);
-            auto result = graph.findCheapestPath(source, dest);
-            cout << "\n--- Cheapest Path ---\n";
-            cout << "Path: ";
-            for (size_t i = 0; i < result.path.size(); i++) {
-                cout << result.path[i];
-                if (i < result.path.size() - 1) cout << " → ";
-            }
-            cout << "\nTotal Cost: $" << result.totalWeight << "\n";
-        }
-        else if (choice == 5) {
-            string source, dest;
-            cout << "Enter source city: ";
-            cin.ignore();
-            getline(cin, source);
-            cout << "Enter destination city: ";
-            getline(cin, dest);
-            auto result = graph.findFastestPath(source, dest);
-            cout << "\n--- Fastest Path ---\n";
-            cout << "Path: ";
-            for (size_t i = 0; i < result.path.size(); i++) {
-                cout << result.path[i];
-                if (i < result.path.size() - 1) cout << " → ";
-            }
-            cout << "\nTotal Time: " << result.totalWeight << " hours\n";
-        }
-        else if (choice == 6) {
-            string source, dest;
-            int numStops;
-            cout << "Enter source city: ";
-            cin.ignore();
-            getline(cin, source);
-            cout << "Enter destination city: ";
-            getline(cin, dest);
-            cout << "Number of stops: ";
-            cin >> numStops;
-            vector<string> stops;
-            cin.ignore();
-            for (int i = 0; i < numStops; i++) {
-                string stop;
-                cout << "Stop " << (i + 1) << ": ";
-                getline(cin, stop);
-                stops.push_back(stop);
-            }
-            auto result = graph.findPathWithStops(source, dest, stops);
-            cout << "\n--- Path with Stops ---\n";
-            cout << "Path: ";
-            for (size_t i = 0; i < result.path.size(); i++) {
-                cout << result.path[i];
-                if (i < result.path.size() - 1) cout << " → ";
-            }
-            cout << "\nTotal Distance: " << result.totalWeight << " km\n";
-        }
-        else if (choice == 7) {
-            string source, dest;
-            cout << "Enter source city: ";
-            cin.ignore();
-            getline(cin, source);
-            cout << "Enter destination city: ";
-            getline(cin, dest);
-            auto paths = graph.getAlternativePaths(source, dest, 3);
-            cout << "\n--- Alternative Paths ---\n";
-            for (size_t i = 0; i < paths.size(); i++) {
-                cout << "Path " << (i + 1) << ": ";
-                for (size_t j = 0; j < paths[i].path.size(); j++) {
-                    cout << paths[i].path[j];
-                    if (j < paths[i].path.size() - 1) cout << " → ";
-                }
-                cout << " (Distance: " << paths[i].totalWeight << " km)\n";
-            }
-        }
-        else if (choice == 8) {
-            auto cities = graph.getAllCities();
-            cout << "\n--- All Cities ---\n";
-            for (size_t i = 0; i < cities.size(); i++) {
-                cout << (i + 1) << ". " << cities[i] << "\n";
-            }
-        }
-    } while (choice != 0);
-}
-
-void itineraryMenu(ItineraryTree& itinerary) {
-    int choice;
-    do {
-        cout << "\n--- ITINERARY MANAGEMENT ---\n";
-        cout << "1. Create Itinerary\n";
-        cout << "2. Add Day\n";
-        cout << "3. Add Activity\n";
-        cout << "4. Remove Activity\n";
-        cout << "5. Move Activity\n";
-        cout << "6. Display Itinerary\n";
-        cout << "7. Get Day Schedule\n";
-        cout << "8. View Total Cost & Duration\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            string name, start, end;
-            cout << "Enter trip name: ";
-            cin.ignore();
-            getline(cin, name);
-            cout << "Start date (YYYY-MM-DD): ";
-            getline(cin, start);
-            cout << "End date (YYYY-MM-DD): ";
-            getline(cin, end);
-            itinerary.createItinerary(name, start, end);
-            cout << "✓ Itinerary created!\n";
-        }
-        else if (choice == 2) {
-            int dayNum;
-            string date;
-            cout << "Enter day number: ";
-            cin >> dayNum;
-            cout << "Enter date (YYYY-MM-DD): ";
-            cin.ignore();
-            getline(cin, date);
-            itinerary.addDay(dayNum, date);
-            cout << "✓ Day added!\n";
-        }
-        else if (choice == 3) {
-            int dayNum;
-            string name, duration, cost;
-            cout << "Enter day number: ";
-            cin >> dayNum;
-            cin.ignore();
-            cout << "Activity name: ";
-            getline(cin, name);
-            cout << "Duration (hours): ";
-            getline(cin, duration);
-            cout << "Cost ($): ";
-            getline(cin, cost);
-
-            map<string, string> activity = {
-                {"id", "act_" + to_string(rand() % 10000)},
-                {"name", name},
-                {"duration", duration},
-                {"cost", cost}
-            };
-            itinerary.addActivity(dayNum, activity);
-            cout << "✓ Activity added!\n";
-        }
-        else if (choice == 4) {
-            int dayNum;
-            string actId;
-            cout << "Enter day number: ";
-            cin >> dayNum;
-            cout << "Enter activity ID: ";
-            cin >> actId;
-            if (itinerary.removeActivity(dayNum, actId)) {
-                cout << "✓ Activity removed!\n";
-            } else {
-                cout << "✗ Activity not found!\n";
-            }
-        }
-        else if (choice == 5) {
-            int fromDay, toDay;
-            string actId;
-            cout << "From day: ";
-            cin >> fromDay;
-            cout << "To day: ";
-            cin >> toDay;
-            cout << "Activity ID: ";
-            cin >> actId;
-            if (itinerary.moveActivity(fromDay, toDay, actId)) {
-                cout << "✓ Activity moved!\n";
-            } else {
-                cout << "✗ Failed to move activity!\n";
-            }
-        }
-        else if (choice == 6) {
-            cout << itinerary.displayItinerary();
-        }
-        else if (choice == 7) {
-            int dayNum;
-            cout << "Enter day number: ";
-            cin >> dayNum;
-            auto schedule = itinerary.getDaySchedule(dayNum);
-            cout << "\n--- Day " << dayNum << " Schedule ---\n";
-            for (size_t i = 0; i < schedule.size(); i++) {
-                cout << (i + 1) << ". " << schedule[i]["name"] << "\n";
-            }
-        }
-        else if (choice == 8) {
-            cout << "\n--- Trip Summary ---\n";
-            cout << "Total Duration: " << itinerary.getTotalDuration() << " hours\n";
-            cout << "Total Cost: $" << itinerary.getTotalCost() << "\n";
-        }
-    } while (choice != 0);
-}
-
-void activityMenu(ActivityManager& activityMgr) {
-    int choice;
-    do {
-        cout << "\n--- ACTIVITY MANAGEMENT ---\n";
-        cout << "1. Add Activity\n";
-        cout << "2. View All Activities (by City)\n";
-        cout << "3. Sort by Cost\n";
-        cout << "4. Sort by Rating\n";
-        cout << "5. Sort by Duration\n";
-        cout << "6. Filter Activities\n";
-        cout << "7. Search by Name\n";
-        cout << "8. Search by Category\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            string name, location, category;
-            double cost, rating, duration;
-            cout << "Activity name: ";
-            cin.ignore();
-            getline(cin, name);
-            cout << "Location: ";
-            getline(cin, location);
-            cout << "Category: ";
-            getline(cin, category);
-            cout << "Cost ($): ";
-            cin >> cost;
-            cout << "Rating (0-5): ";
-            cin >> rating;
-            cout << "Duration (hours): ";
-            cin >> duration;
-
-            activityMgr.addActivityToDB(name, location, category, cost, rating, duration);
-            cout << "✓ Activity added!\n";
-        }
-        else if (choice == 2) {
-            string city;
-            cout << "Enter city: ";
-            cin.ignore();
-            getline(cin, city);
-            auto activities = activityMgr.getAllActivities(city);
-            cout << "\n--- Activities in " << city << " ---\n";
-            for (size_t i = 0; i < activities.size(); i++) {
-                cout << (i + 1) << ". " << activities[i].name
-                     << " | $" << activities[i].cost
-                     << " | ⭐" << activities[i].rating << "\n";
-            }
-        }
-        else if (choice == 3) {
-            string city, order;
-            cout << "Enter city: ";
-            cin.ignore();
-            getline(cin, city);
-            cout << "Order (asc/desc): ";
-            cin >> order;
-            auto activities = activityMgr.getAllActivities(city);
-            activities = activityMgr.sortByCost(activities, order);
-            cout << "\n--- Sorted by Cost ---\n";
-            for (size_t i = 0; i < activities.size(); i++) {
-                cout << (i + 1) << ". " << activities[i].name
-                     << " | $" << activities[i].cost << "\n";
-            }
-        }
-        else if (choice == 4) {
-            string city;
-            cout << "Enter city: ";
-            cin.ignore();
-            getline(cin, city);
-            auto activities = activityMgr.getAllActivities(city);
-            activities = activityMgr.sortByRating(activities);
-            cout << "\n--- Sorted by Rating ---\n";
-            for (size_t i = 0; i < activities.size(); i++) {
-                cout << (i + 1) << ". " << activities[i].name
-                     << " | ⭐" << activities[i].rating << "\n";
-            }
-        }
-        else if (choice == 6) {
-            string city;
-            double maxCost, minRating, maxDuration;
-            cout << "Enter city: ";
-            cin.ignore();
-            getline(cin, city);
-            cout << "Max cost ($): ";
-            cin >> maxCost;
-            cout << "Min rating (0-5): ";
-            cin >> minRating;
-            cout << "Max duration (hours): ";
-            cin >> maxDuration;
-
-            map<string, double> criteria = {
-                {"max_cost", maxCost},
-                {"min_rating", minRating},
-                {"max_duration", maxDuration}
-            };
-
-            auto activities = activityMgr.getAllActivities(city);
-            activities = activityMgr.filterActivities(activities, criteria);
-            cout << "\n--- Filtered Activities ---\n";
-            for (size_t i = 0; i < activities.size(); i++) {
-                cout << (i + 1) << ". " << activities[i].name
-                     << " | $" << activities[i].cost
-                     << " | ⭐" << activities[i].rating
-                     << " | " << activities[i].duration << "h\n";
-            }
-        }
-    } while (choice != 0);
-}
-
-void musicLibraryMenu(MusicTrie& musicTrie) {
-    int choice;
-    do {
-        cout << "\n--- MUSIC LIBRARY ---\n";
-        cout << "1. Add Song\n";
-        cout << "2. Search by Prefix\n";
-        cout << "3. Autocomplete\n";
-        cout << "4. Search by Artist\n";
-        cout << "5. View All Songs\n";
-        cout << "6. Delete Song\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            string name, artist, genre, rating;
-            cout << "Song name: ";
-            cin.ignore();
-            getline(cin, name);
-            cout << "Artist: ";
-            getline(cin, artist);
-            cout << "Genre: ";
-            getline(cin, genre);
-            cout << "Rating (0-5): ";
-            getline(cin, rating);
-
-            map<string, string> metadata = {{"genre", genre}, {"rating", rating}};
-            musicTrie.insertSong(name, artist, metadata);
-            cout << "✓ Song added!\n";
-        }
-        else if (choice == 2) {
-            string prefix;
-            cout << "Enter prefix: ";
-            cin.ignore();
-            getline(cin, prefix);
-            auto songs = musicTrie.searchPrefix(prefix);
-            cout << "\n--- Search Results ---\n";
-            for (size_t i = 0; i < songs.size(); i++) {
-                cout << (i + 1) << ". " << songs[i].name
-                     << " by " << songs[i].artist << "\n";
-            }
-        }
-        else if (choice == 3) {
-            string prefix;
-            int limit;
-            cout << "Enter prefix: ";
-            cin.ignore();
-            getline(cin, prefix);
-            cout << "Number of suggestions: ";
-            cin >> limit;
-            auto songs = musicTrie.autoComplete(prefix, limit);
-            cout << "\n--- Autocomplete Suggestions ---\n";
-            for (size_t i = 0; i < songs.size(); i++) {
-                cout << (i + 1) << ". " << songs[i].name
-                     << " by " << songs[i].artist << "\n";
-            }
-        }
-        else if (choice == 4) {
-            string artist;
-            cout << "Enter artist name: ";
-            cin.ignore();
-            getline(cin, artist);
-            auto songs = musicTrie.searchByArtist(artist);
-            cout << "\n--- Songs by " << artist << " ---\n";
-            for (size_t i = 0; i < songs.size(); i++) {
-                cout << (i + 1) << ". " << songs[i].name << "\n";
-            }
-        }
-        else if (choice == 5) {
-            auto songs = musicTrie.getAllSongs();
-            cout << "\n--- All Songs ---\n";
-            for (size_t i = 0; i < songs.size(); i++) {
-                cout << (i + 1) << ". " << songs[i].name
-                     << " by " << songs[i].artist << "\n";
-            }
-        }
-        else if (choice == 6) {
-            string name;
-            cout << "Enter song name: ";
-            cin.ignore();
-            getline(cin, name);
-            if (musicTrie.deleteSong(name)) {
-                cout << "✓ Song deleted!\n";
-            } else {
-                cout << "✗ Song not found!\n";
-            }
-        }
-    } while (choice != 0);
-}
-
-void frequencyMenu(FrequencyTracker& tracker, MusicTrie& musicTrie) {
-    int choice;
-    do {
-        cout << "\n--- FREQUENCY TRACKING ---\n";
-        cout << "1. Play Song (Increment Count)\n";
-        cout << "2. View Play Count\n";
-        cout << "3. Get Most Played Songs\n";
-        cout << "4. Reset All Frequencies\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            string songId;
-            cout << "Enter song ID/name: ";
-            cin.ignore();
-            getline(cin, songId);
-            tracker.incrementPlayCount(songId);
-            cout << "✓ Play count incremented!\n";
-        }
-        else if (choice == 2) {
-            string songId;
-            cout << "Enter song ID/name: ";
-            cin.ignore();
-            getline(cin, songId);
-            cout << "Play count: " << tracker.getPlayCount(songId) << "\n";
-        }
-        else if (choice == 3) {
-            int k;
-            cout << "How many top songs: ";
-            cin >> k;
-            auto topSongs = tracker.getMostPlayed(k);
-            cout << "\n--- Most Played Songs ---\n";
-            for (size_t i = 0; i < topSongs.size(); i++) {
-                cout << (i + 1) << ". " << topSongs[i].first
-                     << " (" << topSongs[i].second << " plays)\n";
-            }
-        }
-        else if (choice == 4) {
-            tracker.resetFrequencies();
-            cout << "✓ All frequencies reset!\n";
-        }
-    } while (choice != 0);
-}
-
-void playlistMenu(PlaylistHeap& playlistHeap, MusicTrie& musicTrie) {
-    int choice;
-    do {
-        cout << "\n--- PLAYLIST GENERATION ---\n";
-        cout << "1. Generate Playlist\n";
-        cout << "2. View Current Playlist\n";
-        cout << "3. Add Song to Playlist\n";
-        cout << "4. Remove Song from Playlist\n";
-        cout << "5. Shuffle Playlist\n";
-        cout << "0. Back\n";
-        cout << "Choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
-            int duration;
-            string mood, genre;
-            cout << "Trip duration (minutes): ";
-            cin >> duration;
-            cout << "Mood: ";
-            cin.ignore();
-            getline(cin, mood);
-            cout << "Genre: ";
-            getline(cin, genre);
-
-            auto songs = musicTrie.getAllSongs();
-            playlistHeap.buildMaxHeap(songs, "rating");
-            auto playlist = playlistHeap.generatePlaylist(duration, mood, genre);
-
-            cout << "\n✓ Playlist Generated!\n";
-            for (size_t i = 0; i < playlist.size(); i++) {
-                cout << (i + 1) << ". " << playlist[i].name
-                     << " by " << playlist[i].artist << "\n";
-            }
-        }
-        else if (choice == 2) {
-            auto playlist = playlistHeap.getCurrentPlaylist();
-            cout << "\n--- Current Playlist ---\n";
-            for (size_t i = 0; i < playlist.size(); i++) {
-                cout << (i + 1) << ". " << playlist[i].name
-                     << " by " << playlist[i].artist << "\n";
-            }
-        }
-        else if (choice == 5) {
-            auto shuffled = playlistHeap.shufflePlaylist();
-            cout << "\n--- Shuffled Playlist ---\n";
-            for (size_t i = 0; i < shuffled.size(); i++) {
-                cout << (i + 1) << ". " << shuffled[i].name
-                     << " by " << shuffled[i].artist << "\n";
-            }
-        }
-    } while (choice != 0);
-}
-
-int main() {
-    srand(time(0));
-
-    Graph graph;
-    ItineraryTree itinerary;
-    ActivityManager activityMgr;
-    MusicTrie musicTrie;
-    FrequencyTracker tracker;
-    PlaylistHeap playlistHeap;
-
-    graph.addCity("New York");
-    graph.addCity("Boston");
-    graph.addCity("Philadelphia");
-    graph.addCity("Washington DC");
-    graph.addRoute("New York", "Boston", 215, 50, 4);
-    graph.addRoute("New York", "Philadelphia", 95, 30, 2);
-    graph.addRoute("Philadelphia", "Washington DC", 140, 35, 2.5);
-    graph.addRoute("Boston", "Philadelphia", 310, 65, 6);
-
-    activityMgr.addActivityToDB("Statue of Liberty", "New York", "Sightseeing", 25, 4.8, 3);
-    activityMgr.addActivityToDB("Central Park", "New York", "Nature", 0, 4.7, 2);
-    activityMgr.addActivityToDB("Broadway Show", "New York", "Entertainment", 150, 4.9, 3);
-
-    musicTrie.insertSong("Shape of You", "Ed Sheeran", {{"genre", "Pop"}, {"rating", "4.5"}});
-    musicTrie.insertSong("Bohemian Rhapsody", "Queen", {{"genre", "Rock"}, {"rating", "5.0"}});
-    musicTrie.insertSong("Blinding Lights", "The Weeknd", {{"genre", "Pop"}, {"rating", "4.7"}});
-
-    int choice;
-    do {
-        displayMainMenu();
-        cin >> choice;
-
-        switch (choice) {
-            case 1:
-                routePlanningMenu(graph);
-                break;
-            case 2:
-                itineraryMenu(itinerary);
-                break;
-            case 3:
-                activityMenu(activityMgr);
-                break;
-            case 4:
-                musicLibraryMenu(musicTrie);
-                break;
-            case 5:
-                frequencyMenu(tracker, musicTrie);
-                break;
-            case 6:
-                playlistMenu(playlistHeap, musicTrie);
-                break;
-            case 0:
-                cout << "\n Thank you for using Travel Planning System! \n";
-                break;
-            default:
-                cout << "Invalid choice! Please try again.\n";
-        }
-    } while (choice != 0);
-
-    return 0;
-}
-
-
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <algorithm>
+#include <string>
+#include <limits>
+#include <ctime>
+#include <map>
+#include <set>
+#include <cmath>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdint>
+#include <numeric>
+#include <iterator>
+#include <charconv>
+#include <string_view>
+#include <cstdio>
+#if !defined(PORTABLE_FILE_IO) && (defined(__unix__) || defined(__APPLE__))
+#define POSIX_FILE_IO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <filesystem>
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+struct Route {
+    string destination;
+    double distance;
+    double cost;
+    double time;
+};
+
+class Graph {
+private:
+    unordered_map<string, map<string, string>> cities;
+    unordered_map<string, vector<Route>> routes;
+    unsigned long revision = 0;
+
+    struct PathResult {
+        vector<string> path;
+        double totalWeight;
+        string weightType;
+    };
+
+    PathResult dijkstra(const string& source, const string& destination, const string& weightType) {
+        unordered_map<string, double> distances;
+        unordered_map<string, string> previous;
+
+        for (const auto& city : cities) {
+            distances[city.first] = numeric_limits<double>::infinity();
+        }
+        distances[source] = 0;
+
+        auto cmp = [](pair<double, string> a, pair<double, string> b) {
+            return a.first > b.first;
+        };
+        priority_queue<pair<double, string>, vector<pair<double, string>>, decltype(cmp)> pq(cmp);
+        pq.push({0, source});
+
+        while (!pq.empty()) {
+            auto [currentDist, current] = pq.top();
+            pq.pop();
+
+            if (current == destination) break;
+            if (currentDist > distances[current]) continue;
+
+            for (const Route& route : routes[current]) {
+                double weight = 0;
+                if (weightType == "distance") weight = route.distance;
+                else if (weightType == "cost") weight = route.cost;
+                else if (weightType == "time") weight = route.time;
+
+                double distance = currentDist + weight;
+
+                if (distance < distances[route.destination]) {
+                    distances[route.destination] = distance;
+                    previous[route.destination] = current;
+                    pq.push({distance, route.destination});
+                }
+            }
+        }
+
+        vector<string> path;
+        string current = destination;
+        while (!current.empty()) {
+            path.push_back(current);
+            current = previous[current];
+        }
+        reverse(path.begin(), path.end());
+
+        return {path, distances[destination], weightType};
+    }
+
+public:
+    bool addCity(const string& cityName, const map<string, string>& metadata = {}) {
+        if (cities.find(cityName) == cities.end()) {
+            cities[cityName] = metadata;
+            revision++;
+            return true;
+        }
+        return false;
+    }
+
+    void addRoute(const string& city1, const string& city2, double distance, double cost, double time) {
+        routes[city1].push_back({city2, distance, cost, time});
+        routes[city2].push_back({city1, distance, cost, time});
+        revision++;
+    }
+
+    void removeRoute(const string& city1, const string& city2) {
+        auto& routes1 = routes[city1];
+        routes1.erase(remove_if(routes1.begin(), routes1.end(),
+            [&city2](const Route& r) { return r.destination == city2; }), routes1.end());
+
+        auto& routes2 = routes[city2];
+        routes2.erase(remove_if(routes2.begin(), routes2.end(),
+            [&city1](const Route& r) { return r.destination == city1; }), routes2.end());
+        revision++;
+    }
+
+    bool hasCity(const string& cityName) const {
+        return cities.find(cityName) != cities.end();
+    }
+
+    unsigned long getRevision() const {
+        return revision;
+    }
+
+    vector<string> getAllCities() {
+        vector<string> cityList;
+        for (const auto& city : cities) {
+            cityList.push_back(city.first);
+        }
+        return cityList;
+    }
+
+    PathResult findShortestPath(const string& source, const string& destination) {
+        return dijkstra(source, destination, "distance");
+    }
+
+    PathResult findCheapestPath(const string& source, const string& destination) {
+        return dijkstra(source, destination, "cost");
+    }
+
+    PathResult findFastestPath(const string& source, const string& destination) {
+        return dijkstra(source, destination, "time");
+    }
+
+    PathResult findPathWithStops(const string& source, const string& destination, const vector<string>& stops) {
+        vector<string> allStops = {source};
+        allStops.insert(allStops.end(), stops.begin(), stops.end());
+        allStops.push_back(destination);
+
+        vector<string> totalPath;
+        double totalDistance = 0;
+
+        for (size_t i = 0; i < allStops.size() - 1; i++) {
+            PathResult result = findShortestPath(allStops[i], allStops[i + 1]);
+            totalPath.insert(totalPath.end(), result.path.begin(), result.path.end() - 1);
+            totalDistance += result.totalWeight;
+        }
+        totalPath.push_back(destination);
+
+        return {totalPath, totalDistance, "distance"};
+    }
+
+    vector<PathResult> getAlternativePaths(const string& source, const string& destination, int k = 3) {
+        vector<PathResult> paths;
+        PathResult mainPath = findShortestPath(source, destination);
+        paths.push_back(mainPath);
+
+        for (size_t i = 1; i < mainPath.path.size() - 1 && paths.size() < k; i++) {
+            string excludeCity = mainPath.path[i];
+            vector<Route> tempRoutes = routes[excludeCity];
+            routes[excludeCity].clear();
+
+            PathResult altPath = findShortestPath(source, destination);
+            if (altPath.totalWeight != numeric_limits<double>::infinity()) {
+                paths.push_back(altPath);
+            }
+
+            routes[excludeCity] = tempRoutes;
+        }
+
+        return paths;
+    }
+};
+
+class ItineraryNode {
+public:
+    string nodeType;
+    map<string, string> data;
+    vector<ItineraryNode*> children;
+
+    ItineraryNode(const string& type, const map<string, string>& nodeData)
+        : nodeType(type), data(nodeData) {}
+
+    void addChild(ItineraryNode* child) {
+        children.push_back(child);
+    }
+
+    void removeChild(ItineraryNode* child) {
+        children.erase(remove(children.begin(), children.end(), child), children.end());
+    }
+
+    ~ItineraryNode() {
+        for (auto child : children) {
+            delete child;
+        }
+    }
+};
+
+bool parseClockTime(const string& value, double& hours) {
+    const char* text = value.c_str();
+    char* end;
+    double whole = strtod(text, &end);
+    if (end == text || !std::isfinite(whole) || whole < 0) return false;
+    if (*end == '\0') {
+        hours = whole;
+        return true;
+    }
+    if (*end != ':' || whole != floor(whole)) return false;
+
+    const char* minuteText = end + 1;
+    if (!isdigit(static_cast<unsigned char>(*minuteText))) return false;
+    double minutes = strtod(minuteText, &end);
+    if (*end != '\0' || minutes >= 60) return false;
+    hours = whole + minutes / 60.0;
+    return true;
+}
+
+string formatNumber(double value) {
+    ostringstream out;
+    out << value;
+    return out.str();
+}
+
+string formatClockTime(double hours) {
+    int totalMinutes = static_cast<int>(hours * 60 + 0.5);
+    string minutes = to_string(totalMinutes % 60);
+    if (minutes.size() < 2) minutes = "0" + minutes;
+    return to_string(totalMinutes / 60) + ":" + minutes;
+}
+
+class IntervalTree {
+private:
+    struct Node {
+        double start;
+        double end;
+        double maxEnd;
+        ItineraryNode* item;
+        int priority;
+        Node* left;
+        Node* right;
+    };
+
+    Node* root;
+    size_t count;
+
+    static bool keyLess(double startA, ItineraryNode* itemA, double startB, ItineraryNode* itemB) {
+        if (startA != startB) return startA < startB;
+        return less<ItineraryNode*>()(itemA, itemB);
+    }
+
+    static void update(Node* node) {
+        node->maxEnd = node->end;
+        if (node->left) node->maxEnd = max(node->maxEnd, node->left->maxEnd);
+        if (node->right) node->maxEnd = max(node->maxEnd, node->right->maxEnd);
+    }
+
+    static Node* rotateRight(Node* node) {
+        Node* pivot = node->left;
+        node->left = pivot->right;
+        pivot->right = node;
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    static Node* rotateLeft(Node* node) {
+        Node* pivot = node->right;
+        node->right = pivot->left;
+        pivot->left = node;
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    Node* insertHelper(Node* node, Node* fresh) {
+        if (!node) return fresh;
+
+        if (keyLess(fresh->start, fresh->item, node->start, node->item)) {
+            node->left = insertHelper(node->left, fresh);
+            if (node->left->priority > node->priority) node = rotateRight(node);
+        } else {
+            node->right = insertHelper(node->right, fresh);
+            if (node->right->priority > node->priority) node = rotateLeft(node);
+        }
+        update(node);
+        return node;
+    }
+
+    Node* eraseHelper(Node* node, double start, ItineraryNode* item, bool& erased) {
+        if (!node) return nullptr;
+
+        if (node->item == item && node->start == start) {
+            if (!node->left || !node->right) {
+                Node* child = node->left ? node->left : node->right;
+                delete node;
+                erased = true;
+                return child;
+            }
+            if (node->left->priority > node->right->priority) {
+                node = rotateRight(node);
+                node->right = eraseHelper(node->right, start, item, erased);
+            } else {
+                node = rotateLeft(node);
+                node->left = eraseHelper(node->left, start, item, erased);
+            }
+        } else if (keyLess(start, item, node->start, node->item)) {
+            node->left = eraseHelper(node->left, start, item, erased);
+        } else {
+            node->right = eraseHelper(node->right, start, item, erased);
+        }
+        update(node);
+        return node;
+    }
+
+    void overlapHelper(Node* node, double start, double end, vector<ItineraryNode*>& result) const {
+        if (!node || node->maxEnd <= start) return;
+
+        overlapHelper(node->left, start, end, result);
+        if (node->start < end && node->end > start) {
+            result.push_back(node->item);
+        }
+        if (node->start < end) {
+            overlapHelper(node->right, start, end, result);
+        }
+    }
+
+    void destroy(Node* node) {
+        if (!node) return;
+        destroy(node->left);
+        destroy(node->right);
+        delete node;
+    }
+
+public:
+    IntervalTree() : root(nullptr), count(0) {}
+
+    IntervalTree(const IntervalTree&) = delete;
+    IntervalTree& operator=(const IntervalTree&) = delete;
+
+    void insert(double start, double end, ItineraryNode* item) {
+        root = insertHelper(root, new Node{start, end, end, item, rand(), nullptr, nullptr});
+        count++;
+    }
+
+    bool erase(double start, ItineraryNode* item) {
+        bool erased = false;
+        root = eraseHelper(root, start, item, erased);
+        if (erased) count--;
+        return erased;
+    }
+
+    vector<ItineraryNode*> findOverlaps(double start, double end) const {
+        vector<ItineraryNode*> result;
+        overlapHelper(root, start, end, result);
+        return result;
+    }
+
+    ItineraryNode* predecessor(double start, ItineraryNode* item) const {
+        ItineraryNode* best = nullptr;
+        Node* node = root;
+        while (node) {
+            if (keyLess(node->start, node->item, start, item)) {
+                best = node->item;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return best;
+    }
+
+    ItineraryNode* successor(double start, ItineraryNode* item) const {
+        ItineraryNode* best = nullptr;
+        Node* node = root;
+        while (node) {
+            if (keyLess(start, item, node->start, node->item)) {
+                best = node->item;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return best;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    void clear() {
+        destroy(root);
+        root = nullptr;
+        count = 0;
+    }
+
+    ~IntervalTree() {
+        destroy(root);
+    }
+};
+
+struct ScheduleIssue {
+    string type;
+    int dayNumber;
+    string activityId;
+    string otherActivityId;
+    string detail;
+};
+
+class ScheduleChecker {
+private:
+    struct ScheduledActivity {
+        int dayNumber;
+        string id;
+        string name;
+        string location;
+        double start;
+        double end;
+        double duration;
+        double windowOpen;
+        double windowClose;
+    };
+
+    struct DayState {
+        IntervalTree intervals;
+        double bookedHours = 0;
+        set<pair<ItineraryNode*, ItineraryNode*>> overlaps;
+        map<pair<ItineraryNode*, ItineraryNode*>, string> transferConflicts;
+        set<ItineraryNode*> windowViolations;
+    };
+
+    Graph& graph;
+    double dailyHourLimit;
+    unordered_map<int, DayState> days;
+    unordered_map<ItineraryNode*, ScheduledActivity> scheduled;
+    unordered_map<string, double> transferCache;
+    unsigned long cachedRevision;
+
+    static const size_t TRANSFER_CACHE_LIMIT = 1 << 14;
+
+    static double readNumber(const map<string, string>& data, const string& key, double fallback) {
+        auto it = data.find(key);
+        double value;
+        if (it == data.end() || !parseClockTime(it->second, value)) return fallback;
+        return value;
+    }
+
+    static string readString(const map<string, string>& data, const string& key) {
+        auto it = data.find(key);
+        return it == data.end() ? "" : it->second;
+    }
+
+    static pair<ItineraryNode*, ItineraryNode*> orderedPair(ItineraryNode* a, ItineraryNode* b) {
+        return less<ItineraryNode*>()(a, b) ? make_pair(a, b) : make_pair(b, a);
+    }
+
+    void checkTransfer(DayState& day, ItineraryNode* before, ItineraryNode* after) {
+        if (!before || !after) return;
+
+        const ScheduledActivity& first = scheduled[before];
+        const ScheduledActivity& second = scheduled[after];
+        if (first.end > second.start) return;
+
+        double needed = transferTime(first.location, second.location);
+        if (needed == numeric_limits<double>::infinity()) {
+            day.transferConflicts[{before, after}] = "no route from " + first.location + " to " + second.location;
+        } else if (first.end + needed > second.start + 1e-9) {
+            day.transferConflicts[{before, after}] = "needs " + formatNumber(needed) + "h to travel from " +
+                first.location + " to " + second.location;
+        }
+    }
+
+public:
+    ScheduleChecker(Graph& routeGraph, double hourLimit = 12.0)
+        : graph(routeGraph), dailyHourLimit(hourLimit), cachedRevision(routeGraph.getRevision()) {}
+
+    double transferTime(const string& from, const string& to) {
+        if (from.empty() || to.empty() || from == to) return 0;
+
+        if (cachedRevision != graph.getRevision()) {
+            transferCache.clear();
+            cachedRevision = graph.getRevision();
+        }
+
+        string key = from + "\n" + to;
+        auto it = transferCache.find(key);
+        if (it != transferCache.end()) return it->second;
+
+        double hours = numeric_limits<double>::infinity();
+        if (graph.hasCity(from) && graph.hasCity(to)) {
+            hours = graph.findFastestPath(from, to).totalWeight;
+        }
+        if (transferCache.size() + 2 > TRANSFER_CACHE_LIMIT) transferCache.clear();
+        transferCache[key] = hours;
+        transferCache[to + "\n" + from] = hours;
+        return hours;
+    }
+
+    void setDailyHourLimit(double hours) {
+        dailyHourLimit = hours;
+    }
+
+    double getDailyHourLimit() const {
+        return dailyHourLimit;
+    }
+
+    void onActivityAdded(int dayNumber, ItineraryNode* node) {
+        ScheduledActivity activity;
+        activity.dayNumber = dayNumber;
+        activity.id = readString(node->data, "id");
+        activity.name = readString(node->data, "name");
+        activity.location = readString(node->data, "location");
+        activity.duration = readNumber(node->data, "duration", 0);
+        activity.start = readNumber(node->data, "start_time", -1);
+        activity.end = activity.start + activity.duration;
+        activity.windowOpen = readNumber(node->data, "window_open", -1);
+        activity.windowClose = readNumber(node->data, "window_close", -1);
+        scheduled[node] = activity;
+
+        DayState& day = days[dayNumber];
+        day.bookedHours += activity.duration;
+
+        if (activity.start < 0) return;
+
+        if ((activity.windowOpen >= 0 && activity.start < activity.windowOpen) ||
+            (activity.windowClose >= 0 && activity.end > activity.windowClose)) {
+            day.windowViolations.insert(node);
+        }
+
+        for (ItineraryNode* other : day.intervals.findOverlaps(activity.start, activity.end)) {
+            day.overlaps.insert(orderedPair(node, other));
+        }
+
+        ItineraryNode* before = day.intervals.predecessor(activity.start, node);
+        ItineraryNode* after = day.intervals.successor(activity.start, node);
+        day.transferConflicts.erase({before, after});
+        day.intervals.insert(activity.start, activity.end, node);
+        checkTransfer(day, before, node);
+        checkTransfer(day, node, after);
+    }
+
+    void onActivityRemoved(ItineraryNode* node) {
+        auto it = scheduled.find(node);
+        if (it == scheduled.end()) return;
+
+        ScheduledActivity activity = it->second;
+        DayState& day = days[activity.dayNumber];
+        day.bookedHours -= activity.duration;
+
+        if (activity.start >= 0) {
+            day.intervals.erase(activity.start, node);
+            day.windowViolations.erase(node);
+
+            for (ItineraryNode* other : day.intervals.findOverlaps(activity.start, activity.end)) {
+                day.overlaps.erase(orderedPair(node, other));
+            }
+
+            ItineraryNode* before = day.intervals.predecessor(activity.start, node);
+            ItineraryNode* after = day.intervals.successor(activity.start, node);
+            day.transferConflicts.erase({before, node});
+            day.transferConflicts.erase({node, after});
+            checkTransfer(day, before, after);
+        }
+
+        scheduled.erase(it);
+    }
+
+    bool isDayFeasible(int dayNumber) const {
+        auto it = days.find(dayNumber);
+        if (it == days.end()) return true;
+
+        const DayState& day = it->second;
+        return day.bookedHours <= dailyHourLimit + 1e-9 && day.overlaps.empty() &&
+               day.transferConflicts.empty() && day.windowViolations.empty();
+    }
+
+    vector<ScheduleIssue> getDayIssues(int dayNumber) {
+        vector<ScheduleIssue> issues;
+        auto it = days.find(dayNumber);
+        if (it == days.end()) return issues;
+
+        DayState& day = it->second;
+        if (day.bookedHours > dailyHourLimit + 1e-9) {
+            issues.push_back({"over_budget", dayNumber, "", "",
+                formatNumber(day.bookedHours) + "h booked, limit is " + formatNumber(dailyHourLimit) + "h"});
+        }
+
+        for (const auto& overlap : day.overlaps) {
+            const ScheduledActivity& a = scheduled[overlap.first];
+            const ScheduledActivity& b = scheduled[overlap.second];
+            issues.push_back({"overlap", dayNumber, a.id, b.id, a.name + " overlaps with " + b.name});
+        }
+
+        for (const auto& conflict : day.transferConflicts) {
+            const ScheduledActivity& a = scheduled[conflict.first.first];
+            const ScheduledActivity& b = scheduled[conflict.first.second];
+            issues.push_back({"transfer", dayNumber, a.id, b.id, conflict.second});
+        }
+
+        for (ItineraryNode* node : day.windowViolations) {
+            const ScheduledActivity& a = scheduled[node];
+            issues.push_back({"time_window", dayNumber, a.id, "",
+                a.name + " is outside its window " + formatClockTime(max(a.windowOpen, 0.0)) + "-" +
+                (a.windowClose >= 0 ? formatClockTime(a.windowClose) : string("24:00"))});
+        }
+
+        return issues;
+    }
+
+    double getBookedHours(int dayNumber) const {
+        auto it = days.find(dayNumber);
+        return it == days.end() ? 0 : it->second.bookedHours;
+    }
+
+    bool latestActivity(int dayNumber, double& end, string& location) const {
+        auto it = days.find(dayNumber);
+        if (it == days.end()) return false;
+
+        bool found = false;
+        double everything = numeric_limits<double>::max();
+        for (ItineraryNode* node : it->second.intervals.findOverlaps(-everything, everything)) {
+            const ScheduledActivity& activity = scheduled.at(node);
+            if (!found || activity.end > end) {
+                end = activity.end;
+                location = activity.location;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    void clear() {
+        days.clear();
+        scheduled.clear();
+    }
+};
+
+class ItineraryTree {
+private:
+    ItineraryNode* root;
+    ScheduleChecker* scheduleChecker;
+
+public:
+    ItineraryTree() : root(nullptr), scheduleChecker(nullptr) {}
+
+    ScheduleChecker* getScheduleChecker() const {
+        return scheduleChecker;
+    }
+
+    void attachScheduleChecker(ScheduleChecker* checker) {
+        scheduleChecker = checker;
+        if (!scheduleChecker || !root) return;
+
+        scheduleChecker->clear();
+        for (auto dayNode : root->children) {
+            int dayNumber = stoi(dayNode->data["day_number"]);
+            for (auto activityNode : dayNode->children) {
+                scheduleChecker->onActivityAdded(dayNumber, activityNode);
+            }
+        }
+    }
+
+    ItineraryNode* createItinerary(const string& tripName, const string& startDate, const string& endDate) {
+        map<string, string> data = {
+            {"name", tripName},
+            {"start_date", startDate},
+            {"end_date", endDate}
+        };
+        root = new ItineraryNode("trip", data);
+        if (scheduleChecker) scheduleChecker->clear();
+        return root;
+    }
+
+    ItineraryNode* addDay(int dayNumber, const string& date) {
+        if (!root) return nullptr;
+
+        map<string, string> data = {
+            {"day_number", to_string(dayNumber)},
+            {"date", date}
+        };
+        ItineraryNode* dayNode = new ItineraryNode("day", data);
+        root->addChild(dayNode);
+        return dayNode;
+    }
+
+    ItineraryNode* addActivity(int dayNumber, const map<string, string>& activity) {
+        if (!root) return nullptr;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(dayNumber)) {
+                ItineraryNode* activityNode = new ItineraryNode("activity", activity);
+                dayNode->addChild(activityNode);
+                if (scheduleChecker) scheduleChecker->onActivityAdded(dayNumber, activityNode);
+                return activityNode;
+            }
+        }
+        return nullptr;
+    }
+
+    bool removeActivity(int dayNumber, const string& activityId) {
+        if (!root) return false;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(dayNumber)) {
+                for (auto activityNode : dayNode->children) {
+                    if (activityNode->data["id"] == activityId) {
+                        if (scheduleChecker) scheduleChecker->onActivityRemoved(activityNode);
+                        dayNode->removeChild(activityNode);
+                        delete activityNode;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    ItineraryNode* moveActivity(int fromDay, int toDay, const string& activityId) {
+        map<string, string> activityData;
+        ItineraryNode* activityToMove = nullptr;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(fromDay)) {
+                for (auto activityNode : dayNode->children) {
+                    if (activityNode->data["id"] == activityId) {
+                        activityData = activityNode->data;
+                        if (scheduleChecker) scheduleChecker->onActivityRemoved(activityNode);
+                        dayNode->removeChild(activityNode);
+                        delete activityNode;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!activityData.empty()) {
+            return addActivity(toDay, activityData);
+        }
+        return nullptr;
+    }
+
+    ItineraryNode* updateActivity(int dayNumber, const string& activityId, const map<string, string>& changes) {
+        if (!root) return nullptr;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(dayNumber)) {
+                for (auto activityNode : dayNode->children) {
+                    if (activityNode->data["id"] == activityId) {
+                        if (scheduleChecker) scheduleChecker->onActivityRemoved(activityNode);
+                        for (const auto& change : changes) {
+                            activityNode->data[change.first] = change.second;
+                        }
+                        if (scheduleChecker) scheduleChecker->onActivityAdded(dayNumber, activityNode);
+                        return activityNode;
+                    }
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    vector<ScheduleIssue> checkSchedule(int dayNumber) {
+        if (!scheduleChecker) return {};
+        return scheduleChecker->getDayIssues(dayNumber);
+    }
+
+    string displayItinerary() {
+        if (!root) return "No itinerary created";
+
+        string result = "\n============================================================\n";
+        result += "Trip: " + root->data["name"] + "\n";
+        result += "Duration: " + root->data["start_date"] + " to " + root->data["end_date"] + "\n";
+        result += "============================================================\n\n";
+
+        for (auto dayNode : root->children) {
+            result += "Day " + dayNode->data["day_number"] + " - " + dayNode->data["date"] + "\n";
+            result += "----------------------------------------\n";
+
+            if (dayNode->children.empty()) {
+                result += "  No activities planned\n";
+            } else {
+                int count = 1;
+                for (auto activity : dayNode->children) {
+                    result += "  " + to_string(count++) + ". " + activity->data["name"] + "\n";
+                    if (!activity->data["start_time"].empty()) {
+                        result += "     Start: " + activity->data["start_time"] + " | ";
+                    } else {
+                        result += "     ";
+                    }
+                    result += "Duration: " + activity->data["duration"] + " | ";
+                    result += "Cost: $" + activity->data["cost"] + "\n";
+                }
+            }
+            result += "\n";
+        }
+
+        return result;
+    }
+
+    bool hasDay(int dayNumber) {
+        if (!root) return false;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(dayNumber)) return true;
+        }
+        return false;
+    }
+
+    vector<map<string, string>> getDaySchedule(int dayNumber) {
+        vector<map<string, string>> activities;
+        if (!root) return activities;
+
+        for (auto dayNode : root->children) {
+            if (dayNode->data["day_number"] == to_string(dayNumber)) {
+                for (auto activity : dayNode->children) {
+                    activities.push_back(activity->data);
+                }
+                break;
+            }
+        }
+        return activities;
+    }
+
+    double getTotalDuration() {
+        if (!root) return 0;
+
+        double total = 0;
+        for (auto dayNode : root->children) {
+            for (auto activity : dayNode->children) {
+                total += stod(activity->data["duration"]);
+            }
+        }
+        return total;
+    }
+
+    double getTotalCost() {
+        if (!root) return 0;
+
+        double total = 0;
+        for (auto dayNode : root->children) {
+            for (auto activity : dayNode->children) {
+                total += stod(activity->data["cost"]);
+            }
+        }
+        return total;
+    }
+
+    vector<map<string, string>> inOrderTraversal() {
+        vector<map<string, string>> result;
+        inOrderHelper(root, result);
+        return result;
+    }
+
+    void inOrderHelper(ItineraryNode* node, vector<map<string, string>>& result) {
+        if (!node) return;
+
+        if (!node->children.empty()) {
+            inOrderHelper(node->children[0], result);
+        }
+
+        result.push_back(node->data);
+
+        for (size_t i = 1; i < node->children.size(); i++) {
+            inOrderHelper(node->children[i], result);
+        }
+    }
+
+    vector<pair<int, map<string, string>>> preOrderTraversal() {
+        vector<pair<int, map<string, string>>> result;
+        preOrderHelper(root, result, 0);
+        return result;
+    }
+
+    void preOrderHelper(ItineraryNode* node, vector<pair<int, map<string, string>>>& result, int level) {
+        if (!node) return;
+
+        result.push_back({level, node->data});
+        for (auto child : node->children) {
+            preOrderHelper(child, result, level + 1);
+        }
+    }
+
+    ~ItineraryTree() {
+        delete root;
+    }
+};
+
+
+struct Activity {
+    string id;
+    string name;
+    string location;
+    string category;
+    double cost;
+    double rating;
+    double duration;
+    double latitude = numeric_limits<double>::quiet_NaN();
+    double longitude = numeric_limits<double>::quiet_NaN();
+};
+
+class ActivitySpan {
+private:
+    const vector<Activity>* slots;
+    const uint32_t* first;
+    const uint32_t* last;
+
+public:
+    class iterator {
+    private:
+        const vector<Activity>* slots;
+        const uint32_t* current;
+
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef Activity value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Activity* pointer;
+        typedef const Activity& reference;
+
+        iterator() : slots(nullptr), current(nullptr) {}
+        iterator(const vector<Activity>* slotTable, const uint32_t* position) : slots(slotTable), current(position) {}
+
+        const Activity& operator*() const { return (*slots)[*current]; }
+        const Activity* operator->() const { return &(*slots)[*current]; }
+        iterator& operator++() { ++current; return *this; }
+        iterator operator++(int) { iterator previous = *this; ++current; return previous; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+        bool operator==(const iterator& other) const { return current == other.current; }
+    };
+
+    ActivitySpan() : slots(nullptr), first(nullptr), last(nullptr) {}
+
+    ActivitySpan(const vector<Activity>& slotTable, const vector<uint32_t>& rows)
+        : slots(&slotTable), first(rows.data()), last(rows.data() + rows.size()) {}
+
+    iterator begin() const { return iterator(slots, first); }
+    iterator end() const { return iterator(slots, last); }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    const Activity& operator[](size_t i) const { return (*slots)[first[i]]; }
+};
+
+double haversineKm(double lat1, double lon1, double lat2, double lon2) {
+    constexpr double toRadians = 3.14159265358979323846 / 180.0;
+    double dLat = (lat2 - lat1) * toRadians;
+    double dLon = (lon2 - lon1) * toRadians;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * toRadians) * cos(lat2 * toRadians) * sin(dLon / 2) * sin(dLon / 2);
+    return 2 * 6371.0 * asin(min(1.0, sqrt(a)));
+}
+
+struct ActivityQuery {
+    double maxCost = numeric_limits<double>::infinity();
+    double minRating = -numeric_limits<double>::infinity();
+    double maxDuration = numeric_limits<double>::infinity();
+    string category;
+    string location;
+
+    static ActivityQuery fromCriteria(const map<string, double>& criteria) {
+        ActivityQuery query;
+        auto it = criteria.find("max_cost");
+        if (it != criteria.end()) query.maxCost = it->second;
+        it = criteria.find("min_rating");
+        if (it != criteria.end()) query.minRating = it->second;
+        it = criteria.find("max_duration");
+        if (it != criteria.end()) query.maxDuration = it->second;
+        return query;
+    }
+
+    bool matches(const Activity& a) const {
+        return a.cost <= maxCost && a.rating >= minRating && a.duration <= maxDuration &&
+               (category.empty() || a.category == category) &&
+               (location.empty() || a.location == location);
+    }
+};
+
+class ActivityColumns {
+private:
+    vector<float> costColumn;
+    vector<float> ratingColumn;
+    vector<float> durationColumn;
+    vector<int32_t> categoryColumn;
+    vector<int32_t> locationColumn;
+    unordered_map<string, int32_t> categoryCodes;
+    unordered_map<string, int32_t> locationCodes;
+    vector<string> categoryNames;
+    vector<string> locationNames;
+
+    static int32_t encode(unordered_map<string, int32_t>& codes, vector<string>& names, const string& value) {
+        auto it = codes.find(value);
+        if (it != codes.end()) return it->second;
+
+        int32_t code = static_cast<int32_t>(names.size());
+        codes[value] = code;
+        names.push_back(value);
+        return code;
+    }
+
+    static int32_t lookup(const unordered_map<string, int32_t>& codes, const string& value) {
+        auto it = codes.find(value);
+        return it == codes.end() ? -2 : it->second;
+    }
+
+public:
+    void assign(uint32_t row, const Activity& a) {
+        if (row >= costColumn.size()) {
+            costColumn.resize(row + 1);
+            ratingColumn.resize(row + 1);
+            durationColumn.resize(row + 1);
+            categoryColumn.resize(row + 1);
+            locationColumn.resize(row + 1);
+        }
+        costColumn[row] = static_cast<float>(a.cost);
+        ratingColumn[row] = static_cast<float>(a.rating);
+        durationColumn[row] = static_cast<float>(a.duration);
+        categoryColumn[row] = encode(categoryCodes, categoryNames, a.category);
+        locationColumn[row] = encode(locationCodes, locationNames, a.location);
+    }
+
+    void clear(uint32_t row) {
+        costColumn[row] = numeric_limits<float>::quiet_NaN();
+        ratingColumn[row] = numeric_limits<float>::quiet_NaN();
+        durationColumn[row] = numeric_limits<float>::quiet_NaN();
+        categoryColumn[row] = -3;
+        locationColumn[row] = -3;
+    }
+
+    bool isLive(uint32_t row) const {
+        return !std::isnan(costColumn[row]);
+    }
+
+    size_t size() const {
+        return costColumn.size();
+    }
+
+    int32_t categoryCode(const string& category) const {
+        return lookup(categoryCodes, category);
+    }
+
+    int32_t locationCode(const string& location) const {
+        return lookup(locationCodes, location);
+    }
+
+    const string& locationName(int32_t code) const {
+        return locationNames[code];
+    }
+
+    float cost(uint32_t row) const { return costColumn[row]; }
+    float rating(uint32_t row) const { return ratingColumn[row]; }
+    float duration(uint32_t row) const { return durationColumn[row]; }
+    int32_t category(uint32_t row) const { return categoryColumn[row]; }
+    int32_t location(uint32_t row) const { return locationColumn[row]; }
+
+    vector<uint32_t> select(const ActivityQuery& query) const {
+        vector<uint32_t> rows;
+        int32_t category = query.category.empty() ? -1 : lookup(categoryCodes, query.category);
+        int32_t location = query.location.empty() ? -1 : lookup(locationCodes, query.location);
+        if (category == -2 || location == -2) return rows;
+
+        float maxCost = static_cast<float>(query.maxCost);
+        float minRating = static_cast<float>(query.minRating);
+        float maxDuration = static_cast<float>(query.maxDuration);
+        size_t n = size();
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        __m256 vMaxCost = _mm256_set1_ps(maxCost);
+        __m256 vMinRating = _mm256_set1_ps(minRating);
+        __m256 vMaxDuration = _mm256_set1_ps(maxDuration);
+        __m256i vCategory = _mm256_set1_epi32(category);
+        __m256i vLocation = _mm256_set1_epi32(location);
+
+        for (; i + 8 <= n; i += 8) {
+            __m256 keep = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&costColumn[i]), vMaxCost, _CMP_LE_OQ),
+                              _mm256_cmp_ps(_mm256_loadu_ps(&ratingColumn[i]), vMinRating, _CMP_GE_OQ)),
+                _mm256_cmp_ps(_mm256_loadu_ps(&durationColumn[i]), vMaxDuration, _CMP_LE_OQ));
+            if (category >= 0) {
+                __m256i codes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&categoryColumn[i]));
+                keep = _mm256_and_ps(keep, _mm256_castsi256_ps(_mm256_cmpeq_epi32(codes, vCategory)));
+            }
+            if (location >= 0) {
+                __m256i codes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&locationColumn[i]));
+                keep = _mm256_and_ps(keep, _mm256_castsi256_ps(_mm256_cmpeq_epi32(codes, vLocation)));
+            }
+
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(keep));
+            while (mask) {
+                rows.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+                mask &= mask - 1;
+            }
+        }
+#elif defined(__SSE2__)
+        __m128 vMaxCost = _mm_set1_ps(maxCost);
+        __m128 vMinRating = _mm_set1_ps(minRating);
+        __m128 vMaxDuration = _mm_set1_ps(maxDuration);
+        __m128i vCategory = _mm_set1_epi32(category);
+        __m128i vLocation = _mm_set1_epi32(location);
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 keep = _mm_and_ps(
+                _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&costColumn[i]), vMaxCost),
+                           _mm_cmpge_ps(_mm_loadu_ps(&ratingColumn[i]), vMinRating)),
+                _mm_cmple_ps(_mm_loadu_ps(&durationColumn[i]), vMaxDuration));
+            if (category >= 0) {
+                __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&categoryColumn[i]));
+                keep = _mm_and_ps(keep, _mm_castsi128_ps(_mm_cmpeq_epi32(codes, vCategory)));
+            }
+            if (location >= 0) {
+                __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&locationColumn[i]));
+                keep = _mm_and_ps(keep, _mm_castsi128_ps(_mm_cmpeq_epi32(codes, vLocation)));
+            }
+
+            unsigned mask = static_cast<unsigned>(_mm_movemask_ps(keep));
+            while (mask) {
+                rows.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+                mask &= mask - 1;
+            }
+        }
+#endif
+
+        for (; i < n; i++) {
+            if (costColumn[i] <= maxCost && ratingColumn[i] >= minRating && durationColumn[i] <= maxDuration &&
+                (category < 0 || categoryColumn[i] == category) &&
+                (location < 0 || locationColumn[i] == location)) {
+                rows.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return rows;
+    }
+};
+
+template <typename T>
+class SortedList {
+private:
+    vector<T> entries;
+
+public:
+    void add(const T& entry) {
+        if (entries.empty() || !(entry < entries.back())) {
+            entries.push_back(entry);
+        } else {
+            entries.insert(upper_bound(entries.begin(), entries.end(), entry), entry);
+        }
+    }
+
+    void addAll(vector<T>& batch) {
+        sort(batch.begin(), batch.end());
+        size_t middle = entries.size();
+        entries.insert(entries.end(), batch.begin(), batch.end());
+        inplace_merge(entries.begin(), entries.begin() + middle, entries.end());
+    }
+
+    void remove(const T& entry) {
+        auto it = lower_bound(entries.begin(), entries.end(), entry);
+        if (it != entries.end() && *it == entry) entries.erase(it);
+    }
+
+    const vector<T>& items() const {
+        return entries;
+    }
+};
+
+class ActivityIndexes {
+private:
+    typedef pair<float, uint32_t> IndexEntry;
+
+    vector<SortedList<uint32_t>> categoryPostings;
+    vector<SortedList<uint32_t>> locationPostings;
+    SortedList<IndexEntry> costIndex;
+    SortedList<IndexEntry> ratingIndex;
+    SortedList<IndexEntry> durationIndex;
+
+    static void addPosting(vector<SortedList<uint32_t>>& postings, int32_t code, uint32_t row) {
+        if (postings.size() <= static_cast<size_t>(code)) postings.resize(code + 1);
+        postings[code].add(row);
+    }
+
+    static void removePosting(vector<SortedList<uint32_t>>& postings, int32_t code, uint32_t row) {
+        postings[code].remove(row);
+    }
+
+    static const vector<uint32_t>* posting(const vector<SortedList<uint32_t>>& postings, int32_t code) {
+        static const vector<uint32_t> empty;
+        if (code < 0 || static_cast<size_t>(code) >= postings.size()) return &empty;
+        return &postings[code].items();
+    }
+
+    static vector<IndexEntry>::const_iterator firstAbove(const vector<IndexEntry>& index, float value) {
+        return upper_bound(index.begin(), index.end(), IndexEntry{value, numeric_limits<uint32_t>::max()});
+    }
+
+    static vector<IndexEntry>::const_iterator firstAtLeast(const vector<IndexEntry>& index, float value) {
+        return lower_bound(index.begin(), index.end(), IndexEntry{value, 0});
+    }
+
+public:
+    void add(uint32_t row, const ActivityColumns& columns) {
+        addPosting(categoryPostings, columns.category(row), row);
+        addPosting(locationPostings, columns.location(row), row);
+        costIndex.add({columns.cost(row), row});
+        ratingIndex.add({columns.rating(row), row});
+        durationIndex.add({columns.duration(row), row});
+    }
+
+    void addBatch(uint32_t firstRow, uint32_t lastRow, const ActivityColumns& columns) {
+        vector<IndexEntry> costs, ratings, durations;
+        costs.reserve(lastRow - firstRow);
+        ratings.reserve(lastRow - firstRow);
+        durations.reserve(lastRow - firstRow);
+        for (uint32_t row = firstRow; row < lastRow; row++) {
+            addPosting(categoryPostings, columns.category(row), row);
+            addPosting(locationPostings, columns.location(row), row);
+            costs.push_back({columns.cost(row), row});
+            ratings.push_back({columns.rating(row), row});
+            durations.push_back({columns.duration(row), row});
+        }
+        costIndex.addAll(costs);
+        ratingIndex.addAll(ratings);
+        durationIndex.addAll(durations);
+    }
+
+    void remove(uint32_t row, const ActivityColumns& columns) {
+        removePosting(categoryPostings, columns.category(row), row);
+        removePosting(locationPostings, columns.location(row), row);
+        costIndex.remove({columns.cost(row), row});
+        ratingIndex.remove({columns.rating(row), row});
+        durationIndex.remove({columns.duration(row), row});
+    }
+
+    const vector<uint32_t>& categoryRows(int32_t code) const {
+        return *posting(categoryPostings, code);
+    }
+
+    const vector<pair<float, uint32_t>>& ratingOrder() const {
+        return ratingIndex.items();
+    }
+
+    vector<uint32_t> costRange(float minCost, float maxCost) const {
+        vector<uint32_t> rows;
+        const vector<IndexEntry>& costs = costIndex.items();
+        for (auto it = firstAtLeast(costs, minCost), end = firstAbove(costs, maxCost); it < end; ++it) {
+            rows.push_back(it->second);
+        }
+        return rows;
+    }
+
+    template <typename Visit>
+    void forEachMatch(const ActivityQuery& query, const ActivityColumns& columns, Visit visit) const {
+        int32_t category = query.category.empty() ? -1 : columns.categoryCode(query.category);
+        int32_t location = query.location.empty() ? -1 : columns.locationCode(query.location);
+        if (category == -2 || location == -2) return;
+
+        float maxCost = static_cast<float>(query.maxCost);
+        float minRating = static_cast<float>(query.minRating);
+        float maxDuration = static_cast<float>(query.maxDuration);
+
+        const vector<uint32_t>* postings[2];
+        size_t postingCount = 0;
+        if (category >= 0) postings[postingCount++] = posting(categoryPostings, category);
+        if (location >= 0) postings[postingCount++] = posting(locationPostings, location);
+        if (postingCount == 2 && postings[1]->size() < postings[0]->size()) swap(postings[0], postings[1]);
+        size_t bestSize = postingCount > 0 ? postings[0]->size() : columns.size();
+
+        vector<IndexEntry>::const_iterator rangeBegin, rangeEnd;
+        bool useRange = false;
+        auto considerRange = [&](vector<IndexEntry>::const_iterator begin, vector<IndexEntry>::const_iterator end) {
+            if (static_cast<size_t>(end - begin) < bestSize) {
+                rangeBegin = begin;
+                rangeEnd = end;
+                bestSize = end - begin;
+                useRange = true;
+            }
+        };
+        const vector<IndexEntry>& costs = costIndex.items();
+        const vector<IndexEntry>& ratings = ratingIndex.items();
+        const vector<IndexEntry>& durations = durationIndex.items();
+        considerRange(costs.begin(), firstAbove(costs, maxCost));
+        considerRange(firstAtLeast(ratings, minRating), ratings.end());
+        considerRange(durations.begin(), firstAbove(durations, maxDuration));
+
+        auto accept = [&](uint32_t row) {
+            if (columns.cost(row) <= maxCost && columns.rating(row) >= minRating &&
+                columns.duration(row) <= maxDuration &&
+                (category < 0 || columns.category(row) == category) &&
+                (location < 0 || columns.location(row) == location)) {
+                visit(row);
+            }
+        };
+
+        if (useRange) {
+            for (auto it = rangeBegin; it < rangeEnd; ++it) accept(it->second);
+        } else if (postingCount == 2) {
+            auto probe = postings[1]->begin();
+            for (uint32_t row : *postings[0]) {
+                probe = lower_bound(probe, postings[1]->end(), row);
+                if (probe == postings[1]->end()) break;
+                if (*probe == row) accept(row);
+            }
+        } else if (postingCount == 1) {
+            for (uint32_t row : *postings[0]) accept(row);
+        } else {
+            for (uint32_t row = 0; row < columns.size(); row++) accept(row);
+        }
+    }
+
+    vector<uint32_t> query(const ActivityQuery& query, const ActivityColumns& columns) const {
+        vector<uint32_t> rows;
+        forEachMatch(query, columns, [&](uint32_t row) { rows.push_back(row); });
+        if (!is_sorted(rows.begin(), rows.end())) sort(rows.begin(), rows.end());
+        return rows;
+    }
+};
+
+class GeoGrid {
+private:
+    double cellDegrees;
+    unordered_map<int64_t, vector<uint32_t>> cells;
+    vector<double> latitudes;
+    vector<double> longitudes;
+    vector<uint32_t> cellPositions;
+    size_t pointCount;
+
+    static const int64_t LON_CELLS = 1 << 20;
+    static constexpr double RADIANS_PER_DEGREE = 3.14159265358979323846 / 180.0;
+
+    int64_t cellRow(double lat) const { return static_cast<int64_t>(floor((lat + 90.0) / cellDegrees)); }
+    int64_t cellColumn(double lon) const { return static_cast<int64_t>(floor((lon + 180.0) / cellDegrees)); }
+
+    int64_t columnCount() const {
+        return static_cast<int64_t>(ceil(360.0 / cellDegrees));
+    }
+
+    int64_t wrapColumn(int64_t column) const {
+        int64_t columns = columnCount();
+        return ((column % columns) + columns) % columns;
+    }
+
+    const vector<uint32_t>* cellAt(int64_t row, int64_t column) const {
+        auto it = cells.find(row * LON_CELLS + wrapColumn(column));
+        return it == cells.end() ? nullptr : &it->second;
+    }
+
+public:
+    GeoGrid(double cellSizeDegrees = 0.05) : cellDegrees(cellSizeDegrees), pointCount(0) {}
+
+    void insert(uint32_t row, double lat, double lon) {
+        if (latitudes.size() <= row) {
+            latitudes.resize(row + 1, numeric_limits<double>::quiet_NaN());
+            longitudes.resize(row + 1, numeric_limits<double>::quiet_NaN());
+            cellPositions.resize(row + 1, 0);
+        }
+        latitudes[row] = lat;
+        longitudes[row] = lon;
+        vector<uint32_t>& cell = cells[cellRow(lat) * LON_CELLS + wrapColumn(cellColumn(lon))];
+        cellPositions[row] = static_cast<uint32_t>(cell.size());
+        cell.push_back(row);
+        pointCount++;
+    }
+
+    void remove(uint32_t row) {
+        if (row >= latitudes.size() || std::isnan(latitudes[row])) return;
+
+        auto cell = cells.find(cellRow(latitudes[row]) * LON_CELLS + wrapColumn(cellColumn(longitudes[row])));
+        if (cell != cells.end()) {
+            uint32_t moved = cell->second.back();
+            cell->second[cellPositions[row]] = moved;
+            cellPositions[moved] = cellPositions[row];
+            cell->second.pop_back();
+            if (cell->second.empty()) cells.erase(cell);
+        }
+        latitudes[row] = numeric_limits<double>::quiet_NaN();
+        longitudes[row] = numeric_limits<double>::quiet_NaN();
+        pointCount--;
+    }
+
+    vector<pair<double, uint32_t>> withinRadius(double lat, double lon, double radiusKm) const {
+        vector<pair<double, uint32_t>> result;
+        double latSpan = radiusKm / 111.2;
+        double cosLat = cos(min(89.0, fabs(lat) + latSpan) * RADIANS_PER_DEGREE);
+        double lonSpan = min(180.0, radiusKm / (111.2 * max(cosLat, 1e-6)));
+
+        int64_t firstColumn = cellColumn(lon - lonSpan);
+        int64_t lastColumn = min(cellColumn(lon + lonSpan), firstColumn + columnCount() - 1);
+
+        for (int64_t r = cellRow(max(-90.0, lat - latSpan)); r <= cellRow(min(90.0, lat + latSpan)); r++) {
+            for (int64_t c = firstColumn; c <= lastColumn; c++) {
+                const vector<uint32_t>* cell = cellAt(r, c);
+                if (!cell) continue;
+                for (uint32_t row : *cell) {
+                    double distance = haversineKm(lat, lon, latitudes[row], longitudes[row]);
+                    if (distance <= radiusKm) result.push_back({distance, row});
+                }
+            }
+        }
+
+        sort(result.begin(), result.end());
+        return result;
+    }
+
+    vector<pair<double, uint32_t>> nearest(double lat, double lon, size_t k) const {
+        priority_queue<pair<double, uint32_t>> best;
+        auto offer = [&](uint32_t row) {
+            double distance = haversineKm(lat, lon, latitudes[row], longitudes[row]);
+            if (best.size() < k) {
+                best.push({distance, row});
+            } else if (distance < best.top().first) {
+                best.pop();
+                best.push({distance, row});
+            }
+        };
+
+        if (k > 0) {
+            int64_t centerRow = cellRow(lat);
+            int64_t centerColumn = cellColumn(lon);
+            size_t visitedCells = 0;
+
+            for (int64_t ring = 0;; ring++) {
+                if (visitedCells > 4 * pointCount + 64 || 2 * ring + 1 > columnCount()) {
+                    while (!best.empty()) best.pop();
+                    for (uint32_t row = 0; row < latitudes.size(); row++) {
+                        if (!std::isnan(latitudes[row])) offer(row);
+                    }
+                    break;
+                }
+
+                for (int64_t r = centerRow - ring; r <= centerRow + ring; r++) {
+                    bool edgeRow = r == centerRow - ring || r == centerRow + ring;
+                    for (int64_t c = centerColumn - ring; c <= centerColumn + ring; c += edgeRow ? 1 : 2 * ring) {
+                        visitedCells++;
+                        if (const vector<uint32_t>* cell = cellAt(r, c)) {
+                            for (uint32_t row : *cell) offer(row);
+                        }
+                        if (ring == 0) break;
+                    }
+                }
+
+                double reachDegrees = ring * cellDegrees;
+                double cosLat = cos(min(89.0, fabs(lat) + reachDegrees + cellDegrees) * RADIANS_PER_DEGREE);
+                double guaranteedKm = reachDegrees * 111.2 * max(cosLat, 0.0);
+                if (best.size() == k && best.top().first <= guaranteedKm) break;
+            }
+        }
+
+        vector<pair<double, uint32_t>> result;
+        while (!best.empty()) {
+            result.push_back(best.top());
+            best.pop();
+        }
+        reverse(result.begin(), result.end());
+        return result;
+    }
+};
+
+class ActivityTextIndex {
+private:
+    struct Posting {
+        uint32_t row;
+        uint32_t version;
+        float frequency;
+    };
+
+    unordered_map<string, uint32_t> termIds;
+    vector<string> terms;
+    vector<vector<Posting>> postings;
+    vector<uint32_t> stalePostings;
+    vector<uint32_t> rowVersions;
+    unordered_map<uint32_t, vector<uint32_t>> trigramTerms;
+    vector<float> documentLengths;
+    double totalLength;
+    size_t documentCount;
+
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    static vector<string> tokenize(const string& text) {
+        vector<string> tokens;
+        string current;
+        for (char ch : text) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (isalnum(c) || c >= 0x80) {
+                current += static_cast<char>(tolower(c));
+            } else if (!current.empty()) {
+                tokens.push_back(current);
+                current.clear();
+            }
+        }
+        if (!current.empty()) tokens.push_back(current);
+        return tokens;
+    }
+
+    static vector<uint32_t> trigrams(const string& term, bool withEnd) {
+        string padded = "^" + term + (withEnd ? "$" : "");
+        vector<uint32_t> codes;
+        for (size_t i = 0; i + 3 <= padded.size(); i++) {
+            codes.push_back((static_cast<unsigned char>(padded[i]) << 16) |
+                            (static_cast<unsigned char>(padded[i + 1]) << 8) |
+                            static_cast<unsigned char>(padded[i + 2]));
+        }
+        sort(codes.begin(), codes.end());
+        codes.erase(unique(codes.begin(), codes.end()), codes.end());
+        return codes;
+    }
+
+    static uint32_t initialCode(const string& term) {
+        return (static_cast<uint32_t>('^') << 16) | (static_cast<unsigned char>(term[0]) << 8);
+    }
+
+    static int allowedEdits(const string& token) {
+        return token.size() <= 3 ? 0 : token.size() <= 6 ? 1 : 2;
+    }
+
+    static pair<int, bool> boundedDistance(const string& query, const string& term, int bound) {
+        vector<int> previous(term.size() + 1), current(term.size() + 1);
+        for (size_t j = 0; j <= term.size(); j++) previous[j] = static_cast<int>(j);
+
+        for (size_t i = 1; i <= query.size(); i++) {
+            current[0] = static_cast<int>(i);
+            int rowMin = current[0];
+            for (size_t j = 1; j <= term.size(); j++) {
+                int substitution = previous[j - 1] + (query[i - 1] == term[j - 1] ? 0 : 1);
+                current[j] = min(substitution, min(previous[j], current[j - 1]) + 1);
+                rowMin = min(rowMin, current[j]);
+            }
+            if (rowMin > bound) return {bound + 1, false};
+            swap(previous, current);
+        }
+
+        int full = previous[term.size()];
+        int prefix = *min_element(previous.begin(), previous.end());
+        return full <= prefix ? make_pair(full, false) : make_pair(prefix, true);
+    }
+
+    uint32_t termId(const string& term) {
+        auto it = termIds.find(term);
+        if (it != termIds.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(terms.size());
+        termIds[term] = id;
+        terms.push_back(term);
+        postings.emplace_back();
+        stalePostings.push_back(0);
+        for (uint32_t code : trigrams(term, true)) {
+            trigramTerms[code].push_back(id);
+        }
+        trigramTerms[initialCode(term)].push_back(id);
+        return id;
+    }
+
+public:
+    ActivityTextIndex() : totalLength(0), documentCount(0) {}
+
+    void addDocument(uint32_t row, const Activity& activity) {
+        map<uint32_t, float> frequencies;
+        float length = 0;
+        const pair<const string*, float> fields[] = {
+            {&activity.name, 2.0f}, {&activity.location, 1.0f}, {&activity.category, 1.0f}
+        };
+
+        for (const auto& field : fields) {
+            for (const string& token : tokenize(*field.first)) {
+                frequencies[termId(token)] += field.second;
+                length += field.second;
+            }
+        }
+
+        if (rowVersions.size() <= row) rowVersions.resize(row + 1, 0);
+        for (const auto& entry : frequencies) {
+            postings[entry.first].push_back({row, rowVersions[row], entry.second});
+        }
+        if (documentLengths.size() <= row) documentLengths.resize(row + 1, 0);
+        documentLengths[row] = length;
+        totalLength += length;
+        documentCount++;
+    }
+
+    void removeDocument(uint32_t row, const Activity& activity) {
+        vector<uint32_t> ids;
+        for (const string* field : {&activity.name, &activity.location, &activity.category}) {
+            for (const string& token : tokenize(*field)) {
+                auto it = termIds.find(token);
+                if (it != termIds.end()) ids.push_back(it->second);
+            }
+        }
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+        rowVersions[row]++;
+        for (uint32_t id : ids) {
+            vector<Posting>& list = postings[id];
+            if (++stalePostings[id] * 2 <= list.size()) continue;
+
+            list.erase(remove_if(list.begin(), list.end(),
+                [this](const Posting& p) { return p.version != rowVersions[p.row]; }), list.end());
+            stalePostings[id] = 0;
+        }
+
+        totalLength -= documentLengths[row];
+        documentLengths[row] = 0;
+        documentCount--;
+    }
+
+    vector<pair<double, uint32_t>> search(const string& text, size_t k) const {
+        static thread_local vector<float> scores;
+        static thread_local vector<float> tokenScores;
+        if (scores.size() < documentLengths.size()) {
+            scores.resize(documentLengths.size(), 0);
+            tokenScores.resize(documentLengths.size(), 0);
+        }
+        vector<uint32_t> matchedRows;
+        vector<uint32_t> tokenRows;
+        double averageLength = documentCount ? totalLength / documentCount : 1;
+
+        for (const string& token : tokenize(text)) {
+            int bound = allowedEdits(token);
+            vector<uint32_t> queryTrigrams = trigrams(token, false);
+            if (queryTrigrams.empty()) queryTrigrams.push_back(initialCode(token));
+            int required = max(1, static_cast<int>(queryTrigrams.size()) - 3 * bound);
+
+            unordered_map<uint32_t, int> shared;
+            for (uint32_t code : queryTrigrams) {
+                auto it = trigramTerms.find(code);
+                if (it == trigramTerms.end()) continue;
+                for (uint32_t id : it->second) shared[id]++;
+            }
+
+            tokenRows.clear();
+            for (const auto& candidate : shared) {
+                if (candidate.second < required) continue;
+
+                const string& term = terms[candidate.first];
+                pair<int, bool> match = boundedDistance(token, term, bound);
+                if (match.first > bound) continue;
+
+                const vector<Posting>& list = postings[candidate.first];
+                double live = static_cast<double>(list.size() - stalePostings[candidate.first]);
+                double idf = log(1.0 + (documentCount - live + 0.5) / (live + 0.5));
+                double quality = (match.second ? 0.8 : 1.0) / (1 + match.first);
+
+                for (const Posting& posting : list) {
+                    if (posting.version != rowVersions[posting.row]) continue;
+                    double tf = posting.frequency;
+                    double norm = K1 * (1 - B + B * documentLengths[posting.row] / averageLength);
+                    float score = static_cast<float>(quality * idf * tf * (K1 + 1) / (tf + norm));
+                    float& best = tokenScores[posting.row];
+                    if (best == 0) tokenRows.push_back(posting.row);
+                    best = max(best, score);
+                }
+            }
+
+            for (uint32_t row : tokenRows) {
+                if (scores[row] == 0) matchedRows.push_back(row);
+                scores[row] += tokenScores[row];
+                tokenScores[row] = 0;
+            }
+        }
+
+        vector<pair<double, uint32_t>> ranked;
+        ranked.reserve(matchedRows.size());
+        for (uint32_t row : matchedRows) {
+            ranked.push_back({scores[row], row});
+            scores[row] = 0;
+        }
+
+        auto better = [](const pair<double, uint32_t>& a, const pair<double, uint32_t>& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        };
+        k = min(k, ranked.size());
+        partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(), better);
+        ranked.resize(k);
+        return ranked;
+    }
+};
+
+#ifdef POSIX_FILE_IO
+typedef int FileHandle;
+const FileHandle NO_FILE = -1;
+#else
+typedef FILE* FileHandle;
+const FileHandle NO_FILE = nullptr;
+#endif
+
+class FileView {
+private:
+    const char* bytes;
+    size_t length;
+#ifndef POSIX_FILE_IO
+    string contents;
+#endif
+
+public:
+    FileView() : bytes(nullptr), length(0) {}
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    ~FileView() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifdef POSIX_FILE_IO
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(mapped);
+            length = size;
+        }
+        ::close(fd);
+        return true;
+#else
+        error_code error;
+        if (!filesystem::is_regular_file(path, error)) return false;
+        ifstream input(path, ios::binary);
+        if (!input) return false;
+        contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+        if (input.bad()) {
+            contents.clear();
+            return false;
+        }
+        bytes = contents.data();
+        length = contents.size();
+        return true;
+#endif
+    }
+
+    string_view data() const {
+        return string_view(bytes, length);
+    }
+
+    void close() {
+#ifdef POSIX_FILE_IO
+        if (bytes) munmap(const_cast<char*>(bytes), length);
+#else
+        contents.clear();
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+};
+
+FileHandle openAppend(const string& path, uint64_t& size) {
+#ifdef POSIX_FILE_IO
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    size = fd >= 0 && fstat(fd, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+    return fd;
+#else
+    FILE* file = fopen(path.c_str(), "ab");
+    error_code error;
+    uintmax_t bytes = filesystem::file_size(path, error);
+    size = file && !error ? static_cast<uint64_t>(bytes) : 0;
+    return file;
+#endif
+}
+
+bool writeAll(FileHandle file, const string& data) {
+#ifdef POSIX_FILE_IO
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t chunk = write(file, data.data() + written, data.size() - written);
+        if (chunk <= 0) return false;
+        written += static_cast<size_t>(chunk);
+    }
+    return true;
+#else
+    return fwrite(data.data(), 1, data.size(), file) == data.size();
+#endif
+}
+
+bool syncFile(FileHandle file, bool dataOnly = false) {
+#if defined(POSIX_FILE_IO) && defined(__linux__)
+    return (dataOnly ? fdatasync(file) : fsync(file)) == 0;
+#elif defined(POSIX_FILE_IO)
+    return fsync(file) == 0;
+#else
+    return fflush(file) == 0;
+#endif
+}
+
+void closeFile(FileHandle file) {
+    if (file == NO_FILE) return;
+#ifdef POSIX_FILE_IO
+    ::close(file);
+#else
+    fclose(file);
+#endif
+}
+
+void syncDirectoryOf(const string& path) {
+#ifdef POSIX_FILE_IO
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : path.substr(0, max<size_t>(slash, 1));
+    int dir = ::open(directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+#endif
+}
+
+bool replaceFile(const string& path, const string& data) {
+    string temporary = path + ".tmp";
+#ifdef POSIX_FILE_IO
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, data) && fsync(fd) == 0;
+    ::close(fd);
+#else
+    ofstream output(temporary, ios::binary | ios::trunc);
+    output.write(data.data(), static_cast<streamsize>(data.size()));
+    output.close();
+    bool ok = !output.fail();
+    if (ok) remove(path.c_str());
+#endif
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    syncDirectoryOf(path);
+    return true;
+}
+
+bool truncateFile(const string& path, uint64_t size) {
+#ifdef POSIX_FILE_IO
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) return false;
+    bool ok = ftruncate(fd, static_cast<off_t>(size)) == 0 && fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    error_code error;
+    filesystem::resize_file(path, size, error);
+    return !error;
+#endif
+}
+
+bool fileExists(const string& path) {
+#ifdef POSIX_FILE_IO
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+#else
+    error_code error;
+    return filesystem::exists(path, error);
+#endif
+}
+
+vector<string> listDirectory(const string& directory) {
+    vector<string> names;
+#ifdef POSIX_FILE_IO
+    DIR* listing = opendir(directory.c_str());
+    if (!listing) return names;
+    while (dirent* entry = readdir(listing)) names.push_back(entry->d_name);
+    closedir(listing);
+#else
+    error_code error;
+    for (filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        names.push_back(it->path().filename().string());
+    }
+#endif
+    return names;
+}
+
+void appendUtf8(string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+struct ImportStats {
+    size_t rowsImported = 0;
+    size_t rowsRejected = 0;
+    double seconds = 0;
+    double rowsPerSecond = 0;
+};
+
+class ActivityImportParser {
+private:
+    struct Field {
+        string_view text;
+        bool escaped;
+    };
+
+    static string unescapeCsv(string_view text) {
+        string result;
+        for (size_t i = 0; i < text.size(); i++) {
+            result += text[i];
+            if (text[i] == '"' && i + 1 < text.size() && text[i + 1] == '"') i++;
+        }
+        return result;
+    }
+
+    static string unescapeJson(string_view text) {
+        auto hex = [&text](size_t from) {
+            return static_cast<uint32_t>(strtoul(string(text.substr(from, 4)).c_str(), nullptr, 16));
+        };
+        string result;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\\' || i + 1 >= text.size()) {
+                result += text[i];
+                continue;
+            }
+            char next = text[++i];
+            if (next == 'n') result += '\n';
+            else if (next == 't') result += '\t';
+            else if (next == 'r') result += '\r';
+            else if (next == 'u' && i + 4 < text.size()) {
+                uint32_t codePoint = hex(i + 1);
+                i += 4;
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && i + 6 < text.size() && text[i + 1] == '\\' &&
+                    text[i + 2] == 'u') {
+                    uint32_t low = hex(i + 3);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+                appendUtf8(result, codePoint);
+            } else {
+                result += next;
+            }
+        }
+        return result;
+    }
+
+    static bool parseNumber(string_view text, double& value) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '"')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '"' || text.back() == '\r')) text.remove_suffix(1);
+        if (text.empty()) return false;
+        if (text.front() == '+') text.remove_prefix(1);
+        auto result = from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == errc() && result.ptr == text.data() + text.size() && std::isfinite(value);
+    }
+
+    static size_t splitCsv(string_view line, Field* fields, size_t maxFields) {
+        size_t count = 0;
+        size_t i = 0;
+        while (count < maxFields && i <= line.size()) {
+            if (i < line.size() && line[i] == '"') {
+                size_t start = ++i;
+                bool escaped = false;
+                while (i < line.size()) {
+                    if (line[i] == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                        escaped = true;
+                        i += 2;
+                    } else if (line[i] == '"') {
+                        break;
+                    } else {
+                        i++;
+                    }
+                }
+                fields[count++] = {line.substr(start, i - start), escaped};
+                i = line.find(',', i);
+            } else {
+                size_t end = line.find(',', i);
+                fields[count++] = {line.substr(i, (end == string_view::npos ? line.size() : end) - i), false};
+                i = end;
+            }
+            if (i == string_view::npos) break;
+            i++;
+        }
+        return count;
+    }
+
+    static bool parseCsvLine(string_view line, Activity& activity) {
+        Field fields[8];
+        size_t count = splitCsv(line, fields, 8);
+        if (count < 6) return false;
+
+        string* texts[] = {&activity.name, &activity.location, &activity.category};
+        for (int f = 0; f < 3; f++) {
+            *texts[f] = fields[f].escaped ? unescapeCsv(fields[f].text) : string(fields[f].text);
+        }
+
+        if (!parseNumber(fields[3].text, activity.cost) || !parseNumber(fields[4].text, activity.rating) ||
+            !parseNumber(fields[5].text, activity.duration)) {
+            return false;
+        }
+        if (count >= 8 && (!parseNumber(fields[6].text, activity.latitude) ||
+                           !parseNumber(fields[7].text, activity.longitude))) {
+            activity.latitude = activity.longitude = numeric_limits<double>::quiet_NaN();
+        }
+        return true;
+    }
+
+    static bool readJsonString(string_view line, size_t& i, Field& field) {
+        if (i >= line.size() || line[i] != '"') return false;
+        size_t start = ++i;
+        bool escaped = false;
+        while (i < line.size() && line[i] != '"') {
+            if (line[i] == '\\') {
+                escaped = true;
+                i++;
+            }
+            i++;
+        }
+        if (i >= line.size()) return false;
+        field = {line.substr(start, i - start), escaped};
+        i++;
+        return true;
+    }
+
+    static void skipSpaces(string_view line, size_t& i) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+    }
+
+    static bool parseJsonLine(string_view line, Activity& activity) {
+        size_t i = 0;
+        skipSpaces(line, i);
+        if (i >= line.size() || line[i] != '{') return false;
+        i++;
+
+        int required = 0;
+        while (true) {
+            skipSpaces(line, i);
+            if (i < line.size() && line[i] == '}') break;
+
+            Field key, value;
+            if (!readJsonString(line, i, key)) return false;
+            skipSpaces(line, i);
+            if (i >= line.size() || line[i] != ':') return false;
+            i++;
+            skipSpaces(line, i);
+
+            bool isString = i < line.size() && line[i] == '"';
+            if (isString) {
+                if (!readJsonString(line, i, value)) return false;
+            } else {
+                size_t start = i;
+                while (i < line.size() && line[i] != ',' && line[i] != '}') i++;
+                value = {line.substr(start, i - start), false};
+            }
+
+            string text = value.escaped ? unescapeJson(value.text) : string();
+            if (key.text == "name") { activity.name = value.escaped ? text : string(value.text); required |= 1; }
+            else if (key.text == "location") { activity.location = value.escaped ? text : string(value.text); required |= 2; }
+            else if (key.text == "category") { activity.category = value.escaped ? text : string(value.text); required |= 4; }
+            else if (key.text == "cost") { if (parseNumber(value.text, activity.cost)) required |= 8; }
+            else if (key.text == "rating") { if (parseNumber(value.text, activity.rating)) required |= 16; }
+            else if (key.text == "duration") { if (parseNumber(value.text, activity.duration)) required |= 32; }
+            else if (key.text == "latitude") parseNumber(value.text, activity.latitude);
+            else if (key.text == "longitude") parseNumber(value.text, activity.longitude);
+
+            skipSpaces(line, i);
+            if (i < line.size() && line[i] == ',') i++;
+        }
+        return required == 63;
+    }
+
+public:
+    static size_t csvRecordEnd(string_view data, size_t from, bool quoted = false) {
+        while (from < data.size()) {
+            if (quoted) {
+                size_t quote = data.find('"', from);
+                if (quote == string_view::npos) return data.size();
+                quoted = false;
+                from = quote + 1;
+                continue;
+            }
+            size_t newline = data.find('\n', from);
+            if (newline == string_view::npos) newline = data.size();
+            const void* quote = memchr(data.data() + from, '"', newline - from);
+            if (!quote) return newline;
+            quoted = true;
+            from = static_cast<size_t>(static_cast<const char*>(quote) - data.data()) + 1;
+        }
+        return data.size();
+    }
+
+    static void parseChunk(string_view chunk, bool json, vector<Activity>& parsed, size_t& rejected) {
+        size_t position = 0;
+        while (position < chunk.size()) {
+            size_t end = json ? chunk.find('\n', position) : csvRecordEnd(chunk, position);
+            if (end == string_view::npos) end = chunk.size();
+            string_view line = chunk.substr(position, end - position);
+            position = end + 1;
+
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty() || (json && (line == "[" || line == "]"))) continue;
+            if (json && line.back() == ',') line.remove_suffix(1);
+
+            Activity activity;
+            bool ok = json ? parseJsonLine(line, activity) : parseCsvLine(line, activity);
+            if (ok) {
+                parsed.push_back(move(activity));
+            } else {
+                rejected++;
+            }
+        }
+    }
+
+    static bool isCsvHeader(string_view line) {
+        return line.size() >= 5 && (line.substr(0, 5) == "name," || line.substr(0, 5) == "\"name");
+    }
+
+    static vector<size_t> chunkBounds(string_view data, bool json, size_t workers) {
+        vector<size_t> quotes(workers, 0);
+        if (!json) {
+            vector<thread> counters;
+            for (size_t w = 0; w + 1 < workers; w++) {
+                counters.emplace_back([&, w]() {
+                    quotes[w] = count(data.begin() + data.size() * w / workers,
+                                      data.begin() + data.size() * (w + 1) / workers, '"');
+                });
+            }
+            for (auto& t : counters) t.join();
+        }
+
+        vector<size_t> bounds = {0};
+        size_t quotesBefore = 0;
+        for (size_t w = 1; w < workers; w++) {
+            quotesBefore += quotes[w - 1];
+            size_t cut = data.size() * w / workers;
+            bool quoted = quotesBefore % 2 == 1;
+            if (cut < bounds.back()) {
+                cut = bounds.back();
+                quoted = false;
+            }
+            size_t end = json ? data.find('\n', cut) : csvRecordEnd(data, cut, quoted);
+            bounds.push_back(end >= data.size() ? data.size() : end + 1);
+        }
+        bounds.push_back(data.size());
+        return bounds;
+    }
+};
+
+struct ActivityScoreWeights {
+    double rating = 1.0;
+    double cost = 0.0;
+    double duration = 0.0;
+};
+
+struct ActivityCursor {
+    double score = numeric_limits<double>::infinity();
+    uint32_t row = 0;
+    bool started = false;
+};
+
+struct ActivityPage {
+    vector<pair<double, uint32_t>> results;
+    ActivityCursor next;
+    bool hasMore;
+};
+
+enum class ActivitySortKey {
+    Cost,
+    Rating,
+    Duration
+};
+
+class ActivityManager {
+private:
+    unordered_map<string, vector<uint32_t>> activitiesDB;
+    vector<Activity> activitySlots;
+    vector<uint32_t> slotGenerations;
+    vector<uint32_t> cityPositions;
+    vector<uint32_t> freeSlots;
+    ActivityColumns columns;
+    ActivityIndexes indexes;
+    GeoGrid geoIndex;
+    ActivityTextIndex textIndex;
+    unordered_map<string, pair<double, double>> locationCoordinates;
+
+    typedef pair<uint64_t, uint32_t> SortEntry;
+
+    static const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+    static bool validValues(double cost, double rating, double duration, double latitude, double longitude) {
+        return std::isfinite(cost) && std::isfinite(rating) && std::isfinite(duration) &&
+               !std::isinf(latitude) && !std::isinf(longitude);
+    }
+
+    static uint64_t sortableKey(double value, bool descending) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        bits = (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+        return descending ? ~bits : bits;
+    }
+
+    static void radixSort(SortEntry* entries, SortEntry* buffer, size_t count) {
+        SortEntry* source = entries;
+        SortEntry* target = buffer;
+
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t counts[257] = {0};
+            for (size_t i = 0; i < count; i++) {
+                counts[((source[i].first >> shift) & 0xFF) + 1]++;
+            }
+            if (counts[((source[0].first >> shift) & 0xFF) + 1] == count) continue;
+
+            for (int b = 0; b < 256; b++) counts[b + 1] += counts[b];
+            for (size_t i = 0; i < count; i++) {
+                target[counts[(source[i].first >> shift) & 0xFF]++] = source[i];
+            }
+            swap(source, target);
+        }
+
+        if (source != entries) {
+            copy(source, source + count, entries);
+        }
+    }
+
+    static void sortEntries(vector<SortEntry>& entries) {
+        if (entries.size() <= 1) return;
+
+        vector<SortEntry> buffer(entries.size());
+        size_t workers = min<size_t>(max(1u, thread::hardware_concurrency()),
+                                     entries.size() / PARALLEL_SORT_THRESHOLD + 1);
+        size_t chunk = (entries.size() + workers - 1) / workers;
+
+        vector<size_t> bounds;
+        for (size_t begin = 0; begin < entries.size(); begin += chunk) bounds.push_back(begin);
+        bounds.push_back(entries.size());
+
+        if (bounds.size() == 2) {
+            radixSort(entries.data(), buffer.data(), entries.size());
+            return;
+        }
+
+        vector<thread> threads;
+        for (size_t c = 0; c + 1 < bounds.size(); c++) {
+            threads.emplace_back([&entries, &buffer, &bounds, c]() {
+                radixSort(entries.data() + bounds[c], buffer.data() + bounds[c], bounds[c + 1] - bounds[c]);
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        auto keyLess = [](const SortEntry& a, const SortEntry& b) { return a.first < b.first; };
+        while (bounds.size() > 2) {
+            vector<size_t> merged;
+            threads.clear();
+            for (size_t c = 0; c + 1 < bounds.size(); c += 2) {
+                merged.push_back(bounds[c]);
+                if (c + 2 < bounds.size()) {
+                    threads.emplace_back([&entries, &bounds, keyLess, c]() {
+                        inplace_merge(entries.begin() + bounds[c], entries.begin() + bounds[c + 1],
+                                      entries.begin() + bounds[c + 2], keyLess);
+                    });
+                }
+            }
+            merged.push_back(entries.size());
+            for (auto& t : threads) t.join();
+            bounds = merged;
+        }
+    }
+
+    static void applyOrder(vector<Activity>& activities, vector<SortEntry>& entries) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].second == i) continue;
+
+            Activity held = move(activities[i]);
+            size_t current = i;
+            while (entries[current].second != i) {
+                size_t next = entries[current].second;
+                activities[current] = move(activities[next]);
+                entries[current].second = current;
+                current = next;
+            }
+            activities[current] = move(held);
+            entries[current].second = current;
+        }
+    }
+
+    static string makeActivityId(uint32_t slot, uint32_t generation) {
+        return "act_" + to_string(slot) + "_" + to_string(generation);
+    }
+
+    static bool parseActivityId(const string& id, uint32_t& slot, uint32_t& generation) {
+        if (id.compare(0, 4, "act_") != 0) return false;
+
+        size_t separator = id.find('_', 4);
+        if (separator == string::npos || separator == 4 || separator + 1 >= id.size()) return false;
+
+        char* end = nullptr;
+        slot = static_cast<uint32_t>(strtoul(id.c_str() + 4, &end, 10));
+        if (end != id.c_str() + separator) return false;
+        generation = static_cast<uint32_t>(strtoul(id.c_str() + separator + 1, &end, 10));
+        return *end == '\0';
+    }
+
+    int64_t findSlot(const string& id) const {
+        uint32_t slot, generation;
+        if (!parseActivityId(id, slot, generation)) return -1;
+        if (slot >= activitySlots.size() || slotGenerations[slot] != generation) return -1;
+        if (!columns.isLive(slot)) return -1;
+        return slot;
+    }
+
+    void indexRow(uint32_t row) {
+        const Activity& activity = activitySlots[row];
+        vector<uint32_t>& cityRows = activitiesDB[activity.location];
+        cityPositions[row] = static_cast<uint32_t>(cityRows.size());
+        cityRows.push_back(row);
+
+        columns.assign(row, activity);
+        indexes.add(row, columns);
+        textIndex.addDocument(row, activity);
+        if (!std::isnan(activity.latitude) && !std::isnan(activity.longitude)) {
+            geoIndex.insert(row, activity.latitude, activity.longitude);
+        }
+    }
+
+    void unindexRow(uint32_t row) {
+        const Activity& activity = activitySlots[row];
+        vector<uint32_t>& cityRows = activitiesDB[activity.location];
+        uint32_t moved = cityRows.back();
+        cityRows[cityPositions[row]] = moved;
+        cityPositions[moved] = cityPositions[row];
+        cityRows.pop_back();
+
+        indexes.remove(row, columns);
+        columns.clear(row);
+        textIndex.removeDocument(row, activity);
+        geoIndex.remove(row);
+    }
+
+    void insertBatch(vector<vector<Activity>>& batches) {
+        uint32_t firstRow = static_cast<uint32_t>(activitySlots.size());
+        size_t total = 0;
+        for (const auto& batch : batches) total += batch.size();
+        activitySlots.reserve(firstRow + total);
+        slotGenerations.reserve(firstRow + total);
+        cityPositions.reserve(firstRow + total);
+
+        for (auto& batch : batches) {
+            for (Activity& activity : batch) {
+                uint32_t row = static_cast<uint32_t>(activitySlots.size());
+                activity.id = makeActivityId(row, 0);
+
+                auto coordinates = locationCoordinates.find(activity.location);
+                if (std::isnan(activity.latitude) && coordinates != locationCoordinates.end()) {
+                    activity.latitude = coordinates->second.first;
+                    activity.longitude = coordinates->second.second;
+                }
+
+                vector<uint32_t>& cityRows = activitiesDB[activity.location];
+                cityPositions.push_back(static_cast<uint32_t>(cityRows.size()));
+                cityRows.push_back(row);
+                slotGenerations.push_back(0);
+                activitySlots.push_back(move(activity));
+                columns.assign(row, activitySlots[row]);
+            }
+            vector<Activity>().swap(batch);
+        }
+
+        uint32_t lastRow = static_cast<uint32_t>(activitySlots.size());
+        thread indexBuilder([&]() { indexes.addBatch(firstRow, lastRow, columns); });
+        thread textBuilder([&]() {
+            for (uint32_t row = firstRow; row < lastRow; row++) textIndex.addDocument(row, activitySlots[row]);
+        });
+        for (uint32_t row = firstRow; row < lastRow; row++) {
+            const Activity& activity = activitySlots[row];
+            if (!std::isnan(activity.latitude) && !std::isnan(activity.longitude)) {
+                geoIndex.insert(row, activity.latitude, activity.longitude);
+            }
+        }
+        indexBuilder.join();
+        textBuilder.join();
+    }
+
+public:
+    bool importActivities(const string& path, ImportStats& stats) {
+        stats = ImportStats();
+        auto started = chrono::steady_clock::now();
+
+        FileView file;
+        if (!file.open(path)) return false;
+
+        string_view data = file.data();
+        size_t dot = path.rfind('.');
+        string extension = dot == string::npos ? "" : path.substr(dot);
+        bool json = extension == ".json" || extension == ".jsonl" || extension == ".ndjson";
+
+        if (!json && ActivityImportParser::isCsvHeader(data)) {
+            size_t end = ActivityImportParser::csvRecordEnd(data, 0);
+            data.remove_prefix(end == data.size() ? data.size() : end + 1);
+        }
+
+        size_t workers = max(1u, thread::hardware_concurrency());
+        vector<size_t> bounds = ActivityImportParser::chunkBounds(data, json, workers);
+
+        vector<vector<Activity>> parsed(workers);
+        vector<size_t> rejected(workers, 0);
+        vector<thread> threads;
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() {
+                ActivityImportParser::parseChunk(data.substr(bounds[w], bounds[w + 1] - bounds[w]), json,
+                                                 parsed[w], rejected[w]);
+            });
+        }
+        for (auto& t : threads) t.join();
+        file.close();
+
+        for (size_t w = 0; w < workers; w++) {
+            stats.rowsImported += parsed[w].size();
+            stats.rowsRejected += rejected[w];
+        }
+        insertBatch(parsed);
+
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        stats.rowsPerSecond = stats.seconds > 0 ? stats.rowsImported / stats.seconds : 0;
+        return true;
+    }
+
+    void setLocationCoordinates(const string& location, double latitude, double longitude) {
+        locationCoordinates[location] = {latitude, longitude};
+    }
+
+    Activity addActivityToDB(const string& name, const string& location, const string& category,
+                            double cost, double rating, double duration,
+                            double latitude = numeric_limits<double>::quiet_NaN(),
+                            double longitude = numeric_limits<double>::quiet_NaN()) {
+        if (!validValues(cost, rating, duration, latitude, longitude)) return Activity();
+
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(activitySlots.size());
+            activitySlots.emplace_back();
+            slotGenerations.push_back(0);
+            cityPositions.push_back(0);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        Activity activity = {
+            makeActivityId(slot, slotGenerations[slot]),
+            name, location, category, cost, rating, duration
+        };
+
+        auto coordinates = locationCoordinates.find(location);
+        if (std::isnan(latitude) && coordinates != locationCoordinates.end()) {
+            latitude = coordinates->second.first;
+            longitude = coordinates->second.second;
+        }
+        activity.latitude = latitude;
+        activity.longitude = longitude;
+
+        activitySlots[slot] = activity;
+        indexRow(slot);
+        return activity;
+    }
+
+    const Activity* getActivity(const string& id) const {
+        int64_t slot = findSlot(id);
+        return slot < 0 ? nullptr : &activitySlots[slot];
+    }
+
+    bool updateActivity(const string& id, const Activity& updated) {
+        int64_t slot = findSlot(id);
+        if (slot < 0 || !validValues(updated.cost, updated.rating, updated.duration,
+                                     updated.latitude, updated.longitude)) {
+            return false;
+        }
+
+        unindexRow(slot);
+        activitySlots[slot] = updated;
+        activitySlots[slot].id = id;
+        indexRow(slot);
+        return true;
+    }
+
+    bool removeActivity(const string& id) {
+        int64_t slot = findSlot(id);
+        if (slot < 0) return false;
+
+        unindexRow(slot);
+        activitySlots[slot] = Activity();
+        slotGenerations[slot]++;
+        freeSlots.push_back(slot);
+        return true;
+    }
+
+    const Activity& activityAt(uint32_t row) const {
+        return activitySlots[row];
+    }
+
+    ActivitySpan getCityActivities(const string& city) const {
+        auto it = activitiesDB.find(city);
+        if (it == activitiesDB.end()) return ActivitySpan();
+        return ActivitySpan(activitySlots, it->second);
+    }
+
+    vector<uint32_t> findRows(const ActivityQuery& query) const {
+        return columns.select(query);
+    }
+
+    vector<uint32_t> queryRows(const ActivityQuery& query) const {
+        return indexes.query(query, columns);
+    }
+
+    ActivityPage topActivities(const ActivityQuery& query, const ActivityScoreWeights& weights, size_t k,
+                               const ActivityCursor& cursor = ActivityCursor()) const {
+        typedef pair<double, uint32_t> Ranked;
+        auto better = [](const Ranked& a, const Ranked& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        };
+        Ranked last = {cursor.score, cursor.row};
+
+        bool filtered = !query.category.empty() || !query.location.empty() ||
+                        query.maxCost != numeric_limits<double>::infinity() ||
+                        query.minRating != -numeric_limits<double>::infinity() ||
+                        query.maxDuration != numeric_limits<double>::infinity();
+
+        ActivityPage page;
+        if (!filtered && weights.cost == 0 && weights.duration == 0 && weights.rating > 0) {
+            const vector<pair<float, uint32_t>>& order = indexes.ratingOrder();
+            size_t high = order.size();
+            if (cursor.started) {
+                high = partition_point(order.begin(), order.end(), [&](const pair<float, uint32_t>& entry) {
+                    return weights.rating * entry.first <= cursor.score;
+                }) - order.begin();
+            }
+
+            while (high > 0 && page.results.size() <= k) {
+                double score = weights.rating * order[high - 1].first;
+                size_t low = partition_point(order.begin(), order.begin() + high, [&](const pair<float, uint32_t>& entry) {
+                    return weights.rating * entry.first < score;
+                }) - order.begin();
+                for (size_t i = low; i < high && page.results.size() <= k; i++) {
+                    Ranked candidate = {score, order[i].second};
+                    if (!cursor.started || better(last, candidate)) page.results.push_back(candidate);
+                }
+                high = low;
+            }
+            page.hasMore = page.results.size() > k;
+            if (page.hasMore) page.results.resize(k);
+        } else {
+            vector<Ranked>& best = page.results;
+            best.reserve(min(k, columns.size()) + 1);
+            auto offer = [&](uint32_t row) {
+                Ranked candidate = {weights.rating * columns.rating(row) - weights.cost * columns.cost(row) -
+                                    weights.duration * columns.duration(row), row};
+                if (cursor.started && !better(last, candidate)) return;
+                if (best.size() <= k) {
+                    best.push_back(candidate);
+                    push_heap(best.begin(), best.end(), better);
+                } else if (better(candidate, best.front())) {
+                    pop_heap(best.begin(), best.end(), better);
+                    best.back() = candidate;
+                    push_heap(best.begin(), best.end(), better);
+                }
+            };
+            if (filtered) {
+                indexes.forEachMatch(query, columns, offer);
+            } else {
+                for (uint32_t row = 0; row < columns.size(); row++) {
+                    if (columns.isLive(row)) offer(row);
+                }
+            }
+            sort_heap(best.begin(), best.end(), better);
+            page.hasMore = best.size() > k;
+            if (page.hasMore) best.resize(k);
+        }
+
+        page.next = cursor;
+        if (!page.results.empty()) {
+            page.next = {page.results.back().first, page.results.back().second, true};
+        }
+        return page;
+    }
+
+    vector<pair<double, uint32_t>> searchActivities(const string& text, size_t k = 20) const {
+        return textIndex.search(text, k);
+    }
+
+    vector<uint32_t> searchByPriceRange(double minPrice, double maxPrice) const {
+        return indexes.costRange(static_cast<float>(minPrice), static_cast<float>(maxPrice));
+    }
+
+    vector<Activity> getAllActivities(const string& city) const {
+        ActivitySpan span = getCityActivities(city);
+        return vector<Activity>(span.begin(), span.end());
+    }
+
+    vector<Activity> getActivityByCategory(const string& category) {
+        vector<Activity> result;
+        for (uint32_t row : indexes.categoryRows(columns.categoryCode(category))) {
+            result.push_back(activityAt(row));
+        }
+        return result;
+    }
+
+    void sortActivities(vector<Activity>& activities, ActivitySortKey key, bool descending) {
+        vector<SortEntry> entries(activities.size());
+        for (size_t i = 0; i < activities.size(); i++) {
+            double value = key == ActivitySortKey::Cost ? activities[i].cost
+                         : key == ActivitySortKey::Rating ? activities[i].rating
+                         : activities[i].duration;
+            entries[i] = {sortableKey(value, descending), static_cast<uint32_t>(i)};
+        }
+
+        sortEntries(entries);
+        applyOrder(activities, entries);
+    }
+
+    vector<Activity> sortByCost(vector<Activity> activities, const string& order = "asc") {
+        sortActivities(activities, ActivitySortKey::Cost, order != "asc");
+        return activities;
+    }
+
+    vector<Activity> sortByRating(vector<Activity> activities, const string& order = "desc") {
+        sortActivities(activities, ActivitySortKey::Rating, order != "asc");
+        return activities;
+    }
+
+    vector<Activity> sortByDuration(vector<Activity> activities, const string& order = "asc") {
+        sortActivities(activities, ActivitySortKey::Duration, order != "asc");
+        return activities;
+    }
+
+
+    vector<pair<double, uint32_t>> nearestActivities(double latitude, double longitude, size_t k) const {
+        return geoIndex.nearest(latitude, longitude, k);
+    }
+
+    vector<pair<double, uint32_t>> activitiesWithinRadius(double latitude, double longitude, double radiusKm) const {
+        return geoIndex.withinRadius(latitude, longitude, radiusKm);
+    }
+
+    vector<Activity> sortByDistance(vector<Activity> activities, const string& currentLocation,
+                                    size_t k = numeric_limits<size_t>::max()) {
+        k = min(k, activities.size());
+        auto origin = locationCoordinates.find(currentLocation);
+        if (origin == locationCoordinates.end()) {
+            activities.resize(k);
+            return activities;
+        }
+
+        vector<pair<double, uint32_t>> distances(activities.size());
+        for (size_t i = 0; i < activities.size(); i++) {
+            double distance = haversineKm(origin->second.first, origin->second.second,
+                                          activities[i].latitude, activities[i].longitude);
+            distances[i] = {std::isnan(distance) ? numeric_limits<double>::infinity() : distance,
+                            static_cast<uint32_t>(i)};
+        }
+        partial_sort(distances.begin(), distances.begin() + k, distances.end());
+
+        vector<Activity> nearest;
+        nearest.reserve(k);
+        for (size_t i = 0; i < k; i++) {
+            nearest.push_back(move(activities[distances[i].second]));
+        }
+        return nearest;
+    }
+
+    Activity* binarySearchByName(vector<Activity>& activities, const string& name) {
+        sort(activities.begin(), activities.end(),
+            [](const Activity& a, const Activity& b) { return a.name < b.name; });
+
+        int left = 0, right = activities.size() - 1;
+
+        while (left <= right) {
+            int mid = left + (right - left) / 2;
+
+            if (activities[mid].name == name) {
+                return &activities[mid];
+            } else if (activities[mid].name < name) {
+                left = mid + 1;
+            } else {
+                right = mid - 1;
+            }
+        }
+        return nullptr;
+    }
+
+    vector<Activity> binarySearchByPrice(vector<Activity> activities, double maxPrice) {
+        activities.erase(remove_if(activities.begin(), activities.end(),
+            [maxPrice](const Activity& a) { return a.cost > maxPrice; }), activities.end());
+        sortActivities(activities, ActivitySortKey::Cost, false);
+        return activities;
+    }
+
+    vector<Activity> linearSearchByCategory(const vector<Activity>& activities, const string& category) {
+        vector<Activity> result;
+        for (const Activity& a : activities) {
+            if (a.category == category) {
+                result.push_back(a);
+            }
+        }
+        return result;
+    }
+
+    vector<Activity> filterActivities(vector<Activity> activities, const map<string, double>& criteria) {
+        ActivityQuery query = ActivityQuery::fromCriteria(criteria);
+        activities.erase(remove_if(activities.begin(), activities.end(),
+            [&query](const Activity& a) { return !query.matches(a); }), activities.end());
+        return activities;
+    }
+};
+
+
+struct ItineraryPlan {
+    vector<vector<Activity>> days;
+    double totalRating;
+    double totalCost;
+    bool solvedExactly;
+};
+
+class ItineraryBuilder {
+private:
+    struct Candidate {
+        Activity activity;
+        int slots;
+    };
+
+    struct PlanState {
+        vector<int> assignment;
+        vector<int> dayLoad;
+        double cost;
+        double rating;
+    };
+
+    ActivityManager& activityMgr;
+    ScheduleChecker& schedule;
+    double dayStartHour;
+
+    static const int SLOTS_PER_HOUR = 4;
+    static const int APPROXIMATE_BUDGET_UNITS = 400;
+    static constexpr double MAX_DP_CELLS = 4e7;
+
+    bool fitsSchedule(int dayNumber, const string& activityId) {
+        for (const ScheduleIssue& issue : schedule.getDayIssues(dayNumber)) {
+            if (issue.type == "over_budget" || issue.activityId == activityId || issue.otherActivityId == activityId) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool tryAssign(PlanState& state, const vector<Candidate>& candidates, int item, int day,
+                          int daySlots, double budget) {
+        const Candidate& c = candidates[item];
+        if (state.dayLoad[day] + c.slots > daySlots) return false;
+        if (state.cost + c.activity.cost > budget + 1e-9) return false;
+
+        state.assignment[item] = day;
+        state.dayLoad[day] += c.slots;
+        state.cost += c.activity.cost;
+        state.rating += c.activity.rating;
+        return true;
+    }
+
+    static void unassign(PlanState& state, const vector<Candidate>& candidates, int item) {
+        int day = state.assignment[item];
+        const Candidate& c = candidates[item];
+        state.assignment[item] = -1;
+        state.dayLoad[day] -= c.slots;
+        state.cost -= c.activity.cost;
+        state.rating -= c.activity.rating;
+    }
+
+    static PlanState emptyState(size_t items, int days) {
+        return {vector<int>(items, -1), vector<int>(days, 0), 0, 0};
+    }
+
+    static bool packFirstFit(PlanState& state, const vector<Candidate>& candidates, vector<int> items,
+                             int daySlots, double budget) {
+        sort(items.begin(), items.end(), [&candidates](int a, int b) {
+            return candidates[a].slots > candidates[b].slots;
+        });
+
+        bool packedAll = true;
+        for (int item : items) {
+            bool placed = false;
+            for (size_t day = 0; day < state.dayLoad.size() && !placed; day++) {
+                placed = tryAssign(state, candidates, item, day, daySlots, budget);
+            }
+            packedAll = packedAll && placed;
+        }
+        return packedAll;
+    }
+
+    static int knapsackUnits(const vector<Candidate>& candidates, int totalSlots, double budget,
+                             double& unitCost, bool& exact) {
+        unitCost = 1;
+        exact = budget >= 0;
+        if (budget < 0) return 0;
+
+        int64_t divisor = 0;
+        for (const Candidate& c : candidates) {
+            double cents = c.activity.cost * 100;
+            int64_t rounded = llround(cents);
+            if (rounded < 0 || fabs(cents - rounded) > 1e-6) {
+                exact = false;
+                break;
+            }
+            divisor = gcd(divisor, rounded);
+        }
+        if (exact && divisor == 0) return 0;
+
+        double rows = static_cast<double>(candidates.size()) * (totalSlots + 1);
+        if (exact) {
+            double units = floor(budget * 100 / divisor + 1e-6);
+            if (rows * (units + 1) <= MAX_DP_CELLS) {
+                unitCost = divisor / 100.0;
+                return static_cast<int>(units);
+            }
+        }
+
+        exact = false;
+        int units = budget > 0 ? APPROXIMATE_BUDGET_UNITS : 0;
+        if (units > 0) unitCost = budget / units;
+        return units;
+    }
+
+    vector<int> solveKnapsackDP(const vector<Candidate>& candidates, int totalSlots, double budget,
+                                int budgetUnits, double unitCost) {
+        if (budget < 0 || budgetUnits < 0) return {};
+
+        size_t width = static_cast<size_t>(budgetUnits) + 1;
+        size_t cells = (static_cast<size_t>(totalSlots) + 1) * width;
+
+        vector<double> best(cells, 0);
+        vector<vector<bool>> taken(candidates.size(), vector<bool>(cells, false));
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            int slots = candidates[i].slots;
+            int costUnits = max(0, static_cast<int>(ceil(candidates[i].activity.cost / unitCost - 1e-9)));
+            double value = candidates[i].activity.rating;
+
+            for (int t = totalSlots; t >= slots; t--) {
+                for (int b = budgetUnits; b >= costUnits; b--) {
+                    double option = best[(t - slots) * width + (b - costUnits)] + value;
+                    if (option > best[t * width + b]) {
+                        best[t * width + b] = option;
+                        taken[i][t * width + b] = true;
+                    }
+                }
+            }
+        }
+
+        vector<int> chosen;
+        int t = totalSlots, b = budgetUnits;
+        for (int i = static_cast<int>(candidates.size()) - 1; i >= 0; i--) {
+            if (taken[i][t * width + b]) {
+                chosen.push_back(i);
+                t -= candidates[i].slots;
+                b -= max(0, static_cast<int>(ceil(candidates[i].activity.cost / unitCost - 1e-9)));
+            }
+        }
+        return chosen;
+    }
+
+    static void localSearch(PlanState& state, const vector<Candidate>& candidates, int daySlots, double budget,
+                            unsigned seed, chrono::steady_clock::time_point deadline) {
+        mt19937 rng(seed);
+        int items = static_cast<int>(candidates.size());
+        int days = static_cast<int>(state.dayLoad.size());
+        if (items == 0 || days == 0) return;
+
+        uniform_int_distribution<int> pickItem(0, items - 1);
+        uniform_int_distribution<int> pickDay(0, days - 1);
+
+        for (long iteration = 0;; iteration++) {
+            if ((iteration & 255) == 0 && chrono::steady_clock::now() >= deadline) break;
+
+            int item = pickItem(rng);
+            int day = pickDay(rng);
+
+            if (state.assignment[item] >= 0) {
+                int from = state.assignment[item];
+                if (from == day) continue;
+                unassign(state, candidates, item);
+                if (!tryAssign(state, candidates, item, day, daySlots, budget)) {
+                    tryAssign(state, candidates, item, from, daySlots, budget);
+                }
+                continue;
+            }
+
+            if (tryAssign(state, candidates, item, day, daySlots, budget)) continue;
+
+            int victim = pickItem(rng);
+            if (state.assignment[victim] != day) continue;
+            if (candidates[victim].activity.rating >= candidates[item].activity.rating) continue;
+
+            unassign(state, candidates, victim);
+            if (!tryAssign(state, candidates, item, day, daySlots, budget)) {
+                tryAssign(state, candidates, victim, day, daySlots, budget);
+            }
+        }
+    }
+
+    PlanState greedyStart(const vector<Candidate>& candidates, int days, int daySlots, double budget,
+                          unsigned seed) {
+        mt19937 rng(seed);
+        uniform_real_distribution<double> noise(0.8, 1.2);
+
+        vector<pair<double, int>> order;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            double weight = candidates[i].slots / static_cast<double>(daySlots) +
+                            (budget > 0 ? candidates[i].activity.cost / budget : 0) + 1e-3;
+            order.push_back({-candidates[i].activity.rating / weight * noise(rng), static_cast<int>(i)});
+        }
+        sort(order.begin(), order.end());
+
+        PlanState state = emptyState(candidates.size(), days);
+        for (const auto& entry : order) {
+            for (int day = 0; day < days; day++) {
+                if (tryAssign(state, candidates, entry.second, day, daySlots, budget)) break;
+            }
+        }
+        return state;
+    }
+
+    ItineraryPlan toPlan(const PlanState& state, const vector<Candidate>& candidates, bool exact) {
+        ItineraryPlan plan;
+        plan.days.resize(state.dayLoad.size());
+        plan.totalRating = state.rating;
+        plan.totalCost = state.cost;
+        plan.solvedExactly = exact;
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (state.assignment[i] >= 0) {
+                plan.days[state.assignment[i]].push_back(candidates[i].activity);
+            }
+        }
+
+        for (auto& day : plan.days) {
+            stable_sort(day.begin(), day.end(), [](const Activity& a, const Activity& b) {
+                return a.location < b.location;
+            });
+        }
+        return plan;
+    }
+
+public:
+    ItineraryBuilder(ActivityManager& manager, ScheduleChecker& checker, double startHour = 9.0)
+        : activityMgr(manager), schedule(checker), dayStartHour(startHour) {}
+
+    ItineraryPlan buildPlan(const vector<string>& cities, int days, double dailyHours, double budget,
+                            int deadlineMs = 200) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(deadlineMs);
+        int daySlots = static_cast<int>(dailyHours * SLOTS_PER_HOUR + 1e-9);
+
+        vector<Candidate> candidates;
+        for (const string& city : cities) {
+            for (const Activity& a : activityMgr.getCityActivities(city)) {
+                int slots = static_cast<int>(ceil(a.duration * SLOTS_PER_HOUR - 1e-9));
+                if (slots <= daySlots && a.cost <= budget && a.rating > 0) {
+                    candidates.push_back({a, max(slots, 1)});
+                }
+            }
+        }
+
+        if (days <= 0 || candidates.empty()) {
+            return toPlan(emptyState(candidates.size(), max(days, 0)), candidates, true);
+        }
+
+        int totalSlots = daySlots * days;
+        double unitCost;
+        bool exactUnits;
+        int budgetUnits = knapsackUnits(candidates, totalSlots, budget, unitCost, exactUnits);
+        double dpCells = static_cast<double>(candidates.size()) * (totalSlots + 1) * (budgetUnits + 1);
+
+        if (dpCells <= MAX_DP_CELLS) {
+            PlanState state = emptyState(candidates.size(), days);
+            vector<int> chosen = solveKnapsackDP(candidates, totalSlots, budget, budgetUnits, unitCost);
+            bool packed = packFirstFit(state, candidates, chosen, daySlots, budget);
+            if (packed) return toPlan(state, candidates, exactUnits);
+
+            localSearch(state, candidates, daySlots, budget, 1, deadline);
+            return toPlan(state, candidates, false);
+        }
+
+        unsigned workers = max(1u, thread::hardware_concurrency());
+        vector<PlanState> results(workers);
+        vector<thread> threads;
+        for (unsigned w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() {
+                results[w] = greedyStart(candidates, days, daySlots, budget, w + 1);
+                localSearch(results[w], candidates, daySlots, budget, 7919 * (w + 1), deadline);
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        size_t bestIndex = 0;
+        for (size_t w = 1; w < results.size(); w++) {
+            if (results[w].rating > results[bestIndex].rating) bestIndex = w;
+        }
+        return toPlan(results[bestIndex], candidates, false);
+    }
+
+    ItineraryPlan buildItinerary(ItineraryTree& itinerary, const vector<string>& cities, int days,
+                                 double dailyHours, double budget, int deadlineMs = 200) {
+        if (itinerary.getScheduleChecker() != &schedule) itinerary.attachScheduleChecker(&schedule);
+        double hourLimit = schedule.getDailyHourLimit();
+        ItineraryPlan plan = buildPlan(cities, days, min(dailyHours, hourLimit), budget, deadlineMs);
+
+        plan.totalRating = 0;
+        plan.totalCost = 0;
+        vector<Activity> carried;
+        for (size_t day = 0; day < plan.days.size(); day++) {
+            int dayNumber = static_cast<int>(day) + 1;
+            if (!itinerary.hasDay(dayNumber) && !itinerary.addDay(dayNumber, "")) {
+                itinerary.createItinerary("Auto-built Trip", "", "");
+                itinerary.addDay(dayNumber, "");
+            }
+
+            double clock = dayStartHour;
+            double lastEnd;
+            string here;
+            if (schedule.latestActivity(dayNumber, lastEnd, here)) clock = max(clock, lastEnd);
+
+            size_t planned = plan.days[day].size();
+            vector<Activity> pending = move(plan.days[day]);
+            pending.insert(pending.end(), carried.begin(), carried.end());
+            carried.clear();
+
+            vector<Activity> placed;
+            for (const Activity& a : pending) {
+                double travel = schedule.transferTime(here, a.location);
+                double start = ceil((clock + travel) * 60 - 1e-6) / 60;
+                if (travel == numeric_limits<double>::infinity() || start + a.duration > 24 + 1e-9 ||
+                    schedule.getBookedHours(dayNumber) + a.duration > hourLimit + 1e-9) {
+                    carried.push_back(a);
+                    continue;
+                }
+
+                map<string, string> activity = {
+                    {"id", a.id},
+                    {"name", a.name},
+                    {"location", a.location},
+                    {"category", a.category},
+                    {"duration", formatNumber(a.duration)},
+                    {"cost", formatNumber(a.cost)},
+                    {"start_time", formatClockTime(start)}
+                };
+                if (!itinerary.addActivity(dayNumber, activity)) continue;
+                if (!fitsSchedule(dayNumber, a.id)) {
+                    itinerary.removeActivity(dayNumber, a.id);
+                    carried.push_back(a);
+                    continue;
+                }
+
+                placed.push_back(a);
+                plan.totalRating += a.rating;
+                plan.totalCost += a.cost;
+                clock = start + a.duration;
+                here = a.location;
+            }
+            if (placed.size() != planned) plan.solvedExactly = false;
+            plan.days[day] = move(placed);
+        }
+        if (!carried.empty()) plan.solvedExactly = false;
+        return plan;
+    }
+};
+
+
+struct Song {
+    string name;
+    string artist;
+    map<string, string> metadata;
+    double rating = 0;
+    double frequency = 0;
+    double tempo = 0;
+    double duration = 0;
+    double energy = 0;
+    int key = -1;
+};
+
+int parseMusicalKey(const string& text) {
+    string value;
+    for (char c : text) {
+        if (!isspace(static_cast<unsigned char>(c))) value += c;
+    }
+    if (value.empty()) return -1;
+
+    if (isdigit(static_cast<unsigned char>(value[0]))) {
+        char* end;
+        long number = strtol(value.c_str(), &end, 10);
+        size_t used = static_cast<size_t>(end - value.c_str());
+        if (number < 1 || number > 12 || used + 1 != value.size()) return -1;
+        char mode = static_cast<char>(toupper(static_cast<unsigned char>(value[used])));
+        if (mode != 'A' && mode != 'B') return -1;
+        return static_cast<int>(number - 1) * 2 + (mode == 'B' ? 1 : 0);
+    }
+
+    static const int pitches[] = {9, 11, 0, 2, 4, 5, 7};
+    char note = static_cast<char>(toupper(static_cast<unsigned char>(value[0])));
+    if (note < 'A' || note > 'G') return -1;
+    int pitch = pitches[note - 'A'];
+    size_t i = 1;
+    if (i < value.size() && value[i] == '#') {
+        pitch++;
+        i++;
+    } else if (i < value.size() && value[i] == 'b') {
+        pitch += 11;
+        i++;
+    }
+
+    string mode = value.substr(i);
+    transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    bool major = mode.empty() || mode == "maj" || mode == "major";
+    if (!major && mode != "m" && mode != "min" && mode != "minor") return -1;
+
+    int number = (7 * ((pitch + (major ? 0 : 3)) % 12) + 7) % 12;
+    return number * 2 + (major ? 1 : 0);
+}
+
+bool parseSongDuration(const string& value, double& seconds) {
+    const char* text = value.c_str();
+    char* end;
+    double total = strtod(text, &end);
+    if (end == text || !std::isfinite(total) || total < 0) return false;
+
+    for (int fields = 0; *end == ':'; fields++) {
+        if (fields == 2 || total != floor(total)) return false;
+        const char* fieldText = end + 1;
+        if (!isdigit(static_cast<unsigned char>(*fieldText))) return false;
+        double field = strtod(fieldText, &end);
+        if (field >= 60) return false;
+        total = total * 60 + field;
+    }
+    if (*end != '\0') return false;
+    seconds = total;
+    return true;
+}
+
+void parseSongAttributes(Song& song) {
+    auto number = [&song](const char* field) {
+        auto it = song.metadata.find(field);
+        return it == song.metadata.end() ? 0.0 : strtod(it->second.c_str(), nullptr);
+    };
+    song.rating = number("rating");
+    song.frequency = number("frequency");
+    song.tempo = number("tempo");
+    song.energy = number("energy");
+
+    auto key = song.metadata.find("key");
+    song.key = key == song.metadata.end() ? -1 : parseMusicalKey(key->second);
+
+    auto duration = song.metadata.find("duration");
+    if (duration == song.metadata.end() || !parseSongDuration(duration->second, song.duration)) {
+        song.duration = 0;
+    }
+}
+
+size_t stringHeapBytes(const string& text) {
+    return text.capacity() > string().capacity() ? text.capacity() + 1 : 0;
+}
+
+template <typename Tree>
+size_t treeNodeBytes(const Tree& tree) {
+    return tree.size() * (sizeof(typename Tree::value_type) + 4 * sizeof(void*));
+}
+
+template <typename Table>
+size_t hashTableBytes(const Table& table) {
+    size_t buckets = table.bucket_count() > 1 ? table.bucket_count() * sizeof(void*) : 0;
+    return buckets + table.size() * (sizeof(typename Table::value_type) + 2 * sizeof(void*));
+}
+
+size_t songHeapBytes(const Song& song) {
+    size_t bytes = stringHeapBytes(song.name) + stringHeapBytes(song.artist) + treeNodeBytes(song.metadata);
+    for (const auto& entry : song.metadata) bytes += stringHeapBytes(entry.first) + stringHeapBytes(entry.second);
+    return bytes;
+}
+
+struct FuzzySongMatch {
+    const Song* song;
+    int distance;
+};
+
+class TrieNode {
+public:
+    unordered_map<char, TrieNode*> children;
+    bool isEnd;
+    Song* songData;
+
+    TrieNode() : isEnd(false), songData(nullptr) {}
+
+    ~TrieNode() {
+        for (auto& pair : children) {
+            delete pair.second;
+        }
+        delete songData;
+    }
+};
+
+class MusicTrie {
+private:
+    struct RadixNode {
+        uint32_t labelOffset;
+        uint32_t labelLength;
+        uint32_t childOffset;
+        uint32_t childCount;
+        uint32_t childCapacity;
+        int32_t songIndex;
+        uint32_t rankedCount;
+    };
+
+    static constexpr uint32_t RANKED_PER_NODE = 8;
+
+    vector<RadixNode> nodes;
+    vector<unsigned char> childKeys;
+    vector<uint32_t> childNodes;
+    string labels;
+    vector<Song> songs;
+    vector<int32_t> nextSong;
+    vector<double> songRatings;
+    vector<uint64_t> songPlays;
+    vector<uint32_t> rankedSongs;
+    map<string, vector<uint32_t>> artistIndex;
+    unordered_map<string, vector<uint32_t>> genreIndex;
+    set<pair<double, uint32_t>> ratingIndex;
+    vector<uint32_t> freeNodes;
+    vector<uint32_t> freeSongs;
+    size_t wastedEdges;
+    size_t wastedLabels;
+    size_t songCount;
+    uint64_t revision;
+
+    static size_t decodeUtf8(const string& text, size_t i, uint32_t& codePoint) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        size_t length = lead >= 0xF0 && lead < 0xF5 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC2 && lead < 0xE0 ? 2 : 0;
+        if (length == 0 || i + length > text.size()) return 0;
+
+        codePoint = lead & (0x7F >> length);
+        for (size_t k = 1; k < length; k++) {
+            unsigned char next = static_cast<unsigned char>(text[i + k]);
+            if ((next & 0xC0) != 0x80) return 0;
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+        return length;
+    }
+
+    static void appendFolded(string& out, uint32_t c) {
+        static const char latin1[] = "aaaaaa*ceeeeiiii" "dnooooo*ouuuuy**" "aaaaaa*ceeeeiiii" "dnooooo*ouuuuy*y";
+        static const char latinExtended[] = "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkk"
+                                            "llllllllllnnnnnnnnnoooooo**rrrrrrssssssss"
+                                            "ttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+        if (c >= 0x300 && c < 0x370) return;
+        if (c == 0xC6 || c == 0xE6) out += "ae";
+        else if (c == 0xDE || c == 0xFE) out += "th";
+        else if (c == 0xDF || c == 0x1E9E) out += "ss";
+        else if (c == 0x132 || c == 0x133) out += "ij";
+        else if (c == 0x152 || c == 0x153) out += "oe";
+        else if (c >= 0xC0 && c < 0x100 && latin1[c - 0xC0] != '*') out += latin1[c - 0xC0];
+        else if (c >= 0x100 && c < 0x180) out += latinExtended[c - 0x100];
+        else if ((c >= 0x391 && c <= 0x3A9) || (c >= 0x410 && c <= 0x42F)) appendUtf8(out, c + 0x20);
+        else if (c == 0x3C2) appendUtf8(out, 0x3C3);
+        else if (c == 0x401 || c == 0x451) appendUtf8(out, 0x435);
+        else if (c >= 0x400 && c <= 0x40F) appendUtf8(out, c + 0x50);
+        else if (c >= 0xFF01 && c <= 0xFF5E) out += static_cast<char>(tolower(static_cast<int>(c - 0xFEE0)));
+        else appendUtf8(out, c);
+    }
+
+    uint32_t newNode(uint32_t labelOffset, uint32_t labelLength) {
+        RadixNode node = {labelOffset, labelLength, 0, 0, 0, -1, 0};
+        if (!freeNodes.empty()) {
+            uint32_t index = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[index] = node;
+            return index;
+        }
+        nodes.push_back(node);
+        rankedSongs.resize(nodes.size() * RANKED_PER_NODE);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t storeLabel(const string& key, size_t from) {
+        uint32_t offset = static_cast<uint32_t>(labels.size());
+        labels.append(key, from, string::npos);
+        return offset;
+    }
+
+    int findChild(uint32_t node, unsigned char key) const {
+        const RadixNode& n = nodes[node];
+        const unsigned char* keys = childKeys.data() + n.childOffset;
+        if (n.childCount <= 8) {
+            for (uint32_t i = 0; i < n.childCount; i++) {
+                if (keys[i] == key) return static_cast<int>(i);
+            }
+            return -1;
+        }
+        const unsigned char* found = lower_bound(keys, keys + n.childCount, key);
+        return found != keys + n.childCount && *found == key ? static_cast<int>(found - keys) : -1;
+    }
+
+    uint32_t childAt(uint32_t node, int position) const {
+        return childNodes[nodes[node].childOffset + position];
+    }
+
+    void addChild(uint32_t node, uint32_t child) {
+        unsigned char key = static_cast<unsigned char>(labels[nodes[child].labelOffset]);
+        RadixNode& n = nodes[node];
+
+        if (n.childCount == n.childCapacity) {
+            uint32_t capacity = max<uint32_t>(2, n.childCapacity * 2);
+            uint32_t offset = static_cast<uint32_t>(childKeys.size());
+            childKeys.resize(offset + capacity);
+            childNodes.resize(offset + capacity);
+            copy(childKeys.begin() + n.childOffset, childKeys.begin() + n.childOffset + n.childCount,
+                 childKeys.begin() + offset);
+            copy(childNodes.begin() + n.childOffset, childNodes.begin() + n.childOffset + n.childCount,
+                 childNodes.begin() + offset);
+            wastedEdges += n.childCapacity;
+            n.childOffset = offset;
+            n.childCapacity = capacity;
+        }
+
+        uint32_t position = 0;
+        while (position < n.childCount && childKeys[n.childOffset + position] < key) position++;
+        for (uint32_t i = n.childCount; i > position; i--) {
+            childKeys[n.childOffset + i] = childKeys[n.childOffset + i - 1];
+            childNodes[n.childOffset + i] = childNodes[n.childOffset + i - 1];
+        }
+        childKeys[n.childOffset + position] = key;
+        childNodes[n.childOffset + position] = child;
+        n.childCount++;
+    }
+
+    void removeChild(uint32_t node, int position) {
+        RadixNode& n = nodes[node];
+        for (uint32_t i = position; i + 1 < n.childCount; i++) {
+            childKeys[n.childOffset + i] = childKeys[n.childOffset + i + 1];
+            childNodes[n.childOffset + i] = childNodes[n.childOffset + i + 1];
+        }
+        n.childCount--;
+    }
+
+    void mergeWithOnlyChild(uint32_t node) {
+        uint32_t child = childAt(node, 0);
+        string label = labels.substr(nodes[node].labelOffset, nodes[node].labelLength) +
+                       labels.substr(nodes[child].labelOffset, nodes[child].labelLength);
+        uint32_t offset = static_cast<uint32_t>(labels.size());
+        labels += label;
+
+        wastedEdges += nodes[node].childCapacity;
+        wastedLabels += nodes[node].labelLength;
+        RadixNode merged = nodes[child];
+        merged.labelOffset = offset;
+        merged.labelLength = nodes[node].labelLength + nodes[child].labelLength;
+        nodes[node] = merged;
+        copyRanked(child, node);
+        releaseNode(child);
+    }
+
+    void releaseNode(uint32_t node) {
+        wastedLabels += nodes[node].labelLength;
+        nodes[node] = {0, 0, 0, 0, 0, -1, 0};
+        freeNodes.push_back(node);
+    }
+
+    void compactEdges() {
+        if (wastedEdges < 1024 || wastedEdges * 2 < childKeys.size()) return;
+
+        vector<unsigned char> keys;
+        vector<uint32_t> children;
+        for (RadixNode& node : nodes) {
+            uint32_t offset = static_cast<uint32_t>(keys.size());
+            keys.insert(keys.end(), childKeys.begin() + node.childOffset,
+                        childKeys.begin() + node.childOffset + node.childCount);
+            children.insert(children.end(), childNodes.begin() + node.childOffset,
+                            childNodes.begin() + node.childOffset + node.childCount);
+            node.childOffset = offset;
+            node.childCapacity = node.childCount;
+        }
+        childKeys.swap(keys);
+        childNodes.swap(children);
+        wastedEdges = 0;
+    }
+
+    void compactLabels() {
+        if (wastedLabels < 4096 || wastedLabels * 2 < labels.size()) return;
+
+        string packed;
+        packed.reserve(labels.size() - wastedLabels);
+        for (RadixNode& node : nodes) {
+            uint32_t offset = static_cast<uint32_t>(packed.size());
+            packed.append(labels, node.labelOffset, node.labelLength);
+            node.labelOffset = offset;
+        }
+        labels.swap(packed);
+        wastedLabels = 0;
+    }
+
+    size_t commonPrefix(const RadixNode& node, const string& key, size_t from) const {
+        size_t length = 0;
+        while (length < node.labelLength && from + length < key.size() &&
+               labels[node.labelOffset + length] == key[from + length]) {
+            length++;
+        }
+        return length;
+    }
+
+    int64_t locate(const string& key, bool allowPartialEdge) const {
+        uint32_t node = 0;
+        size_t i = 0;
+        while (i < key.size()) {
+            int position = findChild(node, static_cast<unsigned char>(key[i]));
+            if (position < 0) return -1;
+
+            node = childAt(node, position);
+            size_t matched = commonPrefix(nodes[node], key, i);
+            if (matched < nodes[node].labelLength) {
+                return (allowPartialEdge && i + matched == key.size()) ? static_cast<int64_t>(node) : -1;
+            }
+            i += matched;
+        }
+        return node;
+    }
+
+    static void eraseIndexed(vector<uint32_t>& ids, uint32_t index) {
+        auto it = find(ids.begin(), ids.end(), index);
+        if (it != ids.end()) {
+            *it = ids.back();
+            ids.pop_back();
+        }
+    }
+
+    void indexSong(uint32_t index) {
+        const Song& song = songs[index];
+        artistIndex[normalizeKey(song.artist)].push_back(index);
+        auto genre = song.metadata.find("genre");
+        if (genre != song.metadata.end()) genreIndex[normalizeKey(genre->second)].push_back(index);
+        ratingIndex.insert({songRatings[index], index});
+    }
+
+    void unindexSong(uint32_t index) {
+        const Song& song = songs[index];
+        auto artist = artistIndex.find(normalizeKey(song.artist));
+        if (artist != artistIndex.end()) {
+            eraseIndexed(artist->second, index);
+            if (artist->second.empty()) artistIndex.erase(artist);
+        }
+        auto genre = song.metadata.find("genre");
+        if (genre != song.metadata.end()) {
+            auto ids = genreIndex.find(normalizeKey(genre->second));
+            if (ids != genreIndex.end()) {
+                eraseIndexed(ids->second, index);
+                if (ids->second.empty()) genreIndex.erase(ids);
+            }
+        }
+        ratingIndex.erase({songRatings[index], index});
+    }
+
+    vector<const Song*> resolve(const vector<uint32_t>& ids) const {
+        vector<const Song*> result;
+        result.reserve(ids.size());
+        for (uint32_t index : ids) result.push_back(&songs[index]);
+        return result;
+    }
+
+    bool ranksBefore(uint32_t a, uint32_t b) const {
+        if (songPlays[a] != songPlays[b]) return songPlays[a] > songPlays[b];
+        if (songRatings[a] != songRatings[b]) return songRatings[a] > songRatings[b];
+        if (songs[a].name != songs[b].name) return songs[a].name < songs[b].name;
+        if (songs[a].artist != songs[b].artist) return songs[a].artist < songs[b].artist;
+        return a < b;
+    }
+
+    uint32_t* rankedAt(uint32_t node) {
+        return rankedSongs.data() + static_cast<size_t>(node) * RANKED_PER_NODE;
+    }
+
+    const uint32_t* rankedAt(uint32_t node) const {
+        return rankedSongs.data() + static_cast<size_t>(node) * RANKED_PER_NODE;
+    }
+
+    void copyRanked(uint32_t from, uint32_t to) {
+        copy(rankedAt(from), rankedAt(from) + nodes[from].rankedCount, rankedAt(to));
+        nodes[to].rankedCount = nodes[from].rankedCount;
+    }
+
+    bool rankedContains(uint32_t node, uint32_t song) const {
+        const uint32_t* ranked = rankedAt(node);
+        return find(ranked, ranked + nodes[node].rankedCount, song) != ranked + nodes[node].rankedCount;
+    }
+
+    void offerRanked(uint32_t node, uint32_t song) {
+        uint32_t* ranked = rankedAt(node);
+        uint32_t& count = nodes[node].rankedCount;
+
+        uint32_t* existing = find(ranked, ranked + count, song);
+        if (existing != ranked + count) {
+            copy(existing + 1, ranked + count, existing);
+            count--;
+        }
+
+        uint32_t position = 0;
+        while (position < count && ranksBefore(ranked[position], song)) position++;
+        if (position == RANKED_PER_NODE) return;
+
+        if (count < RANKED_PER_NODE) count++;
+        for (uint32_t i = count - 1; i > position; i--) ranked[i] = ranked[i - 1];
+        ranked[position] = song;
+    }
+
+    void rebuildRanked(uint32_t node) {
+        vector<uint32_t> candidates;
+        for (int32_t song = nodes[node].songIndex; song >= 0; song = nextSong[song]) {
+            candidates.push_back(static_cast<uint32_t>(song));
+        }
+        for (uint32_t i = 0; i < nodes[node].childCount; i++) {
+            uint32_t child = childAt(node, i);
+            candidates.insert(candidates.end(), rankedAt(child), rankedAt(child) + nodes[child].rankedCount);
+        }
+
+        size_t keep = min<size_t>(candidates.size(), RANKED_PER_NODE);
+        partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                     [this](uint32_t a, uint32_t b) { return ranksBefore(a, b); });
+        copy(candidates.begin(), candidates.begin() + keep, rankedAt(node));
+        nodes[node].rankedCount = static_cast<uint32_t>(keep);
+    }
+
+    void rebuildAllRanked() {
+        vector<pair<uint32_t, bool>> stack = {{0, false}};
+        while (!stack.empty()) {
+            pair<uint32_t, bool> top = stack.back();
+            stack.pop_back();
+            if (top.second) {
+                rebuildRanked(top.first);
+                continue;
+            }
+            stack.push_back({top.first, true});
+            for (uint32_t i = 0; i < nodes[top.first].childCount; i++) {
+                stack.push_back({childAt(top.first, i), false});
+            }
+        }
+    }
+
+    bool findPath(const string& key, vector<uint32_t>& path) const {
+        uint32_t node = 0;
+        size_t i = 0;
+        path.push_back(node);
+        while (i < key.size()) {
+            int position = findChild(node, static_cast<unsigned char>(key[i]));
+            if (position < 0) return false;
+
+            node = childAt(node, position);
+            size_t matched = commonPrefix(nodes[node], key, i);
+            if (matched < nodes[node].labelLength) return false;
+            path.push_back(node);
+            i += matched;
+        }
+        return nodes[node].songIndex >= 0;
+    }
+
+    struct Partition {
+        vector<RadixNode> nodes;
+        vector<unsigned char> childKeys;
+        vector<uint32_t> childNodes;
+        string labels;
+        vector<uint32_t> order;
+        vector<int32_t> next;
+    };
+
+    static uint32_t buildRange(Partition& part, const vector<string>& keys, size_t lo, size_t hi, size_t depth) {
+        const string& first = keys[part.order[lo]];
+        const string& last = keys[part.order[hi - 1]];
+        size_t shared = depth;
+        while (shared < first.size() && shared < last.size() && first[shared] == last[shared]) shared++;
+
+        uint32_t node = static_cast<uint32_t>(part.nodes.size());
+        part.nodes.push_back({static_cast<uint32_t>(part.labels.size()), static_cast<uint32_t>(shared - depth),
+                              0, 0, 0, -1, 0});
+        part.labels.append(first, depth, shared - depth);
+        if (first.size() == shared) {
+            part.nodes[node].songIndex = static_cast<int32_t>(lo);
+            while (lo + 1 < hi && keys[part.order[lo + 1]].size() == shared) {
+                part.next[lo] = static_cast<int32_t>(lo + 1);
+                lo++;
+            }
+            lo++;
+        }
+
+        vector<size_t> groups;
+        for (size_t i = lo; i < hi; i++) {
+            if (i == lo || keys[part.order[i]][shared] != keys[part.order[i - 1]][shared]) groups.push_back(i);
+        }
+        groups.push_back(hi);
+
+        uint32_t childCount = static_cast<uint32_t>(groups.size() - 1);
+        uint32_t offset = static_cast<uint32_t>(part.childKeys.size());
+        part.childKeys.resize(offset + childCount);
+        part.childNodes.resize(offset + childCount);
+        part.nodes[node].childOffset = offset;
+        part.nodes[node].childCount = childCount;
+        part.nodes[node].childCapacity = childCount;
+
+        for (uint32_t g = 0; g < childCount; g++) {
+            part.childKeys[offset + g] = static_cast<unsigned char>(keys[part.order[groups[g]]][shared]);
+            part.childNodes[offset + g] = buildRange(part, keys, groups[g], groups[g + 1], shared);
+        }
+        return node;
+    }
+
+    template <typename T>
+    static void appendValue(string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void appendArray(string& out, const vector<T>& values) {
+        appendValue(out, static_cast<uint64_t>(values.size()));
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    static void appendString(string& out, const string& text) {
+        appendValue(out, static_cast<uint32_t>(text.size()));
+        out += text;
+    }
+
+    struct ImageReader {
+        const char* data;
+        size_t size;
+        size_t position;
+        bool ok;
+
+        template <typename T>
+        T value() {
+            T result{};
+            if (position + sizeof(T) > size) {
+                ok = false;
+                return result;
+            }
+            memcpy(&result, data + position, sizeof(T));
+            position += sizeof(T);
+            return result;
+        }
+
+        template <typename T>
+        void array(vector<T>& values) {
+            uint64_t count = value<uint64_t>();
+            if (!ok || count > (size - position) / sizeof(T)) {
+                ok = false;
+                return;
+            }
+            values.resize(count);
+            if (count > 0) memcpy(values.data(), data + position, count * sizeof(T));
+            position += count * sizeof(T);
+        }
+
+        string text() {
+            uint32_t length = value<uint32_t>();
+            if (!ok || length > size - position) {
+                ok = false;
+                return string();
+            }
+            string result(data + position, length);
+            position += length;
+            return result;
+        }
+    };
+
+    static constexpr uint64_t IMAGE_MAGIC = 0x3245495254545454ULL;
+
+    template <typename Visitor>
+    void forEachSong(uint32_t start, Visitor visit) const {
+        vector<uint32_t> stack = {start};
+        while (!stack.empty()) {
+            uint32_t node = stack.back();
+            stack.pop_back();
+
+            for (int32_t song = nodes[node].songIndex; song >= 0; song = nextSong[song]) visit(songs[song]);
+            for (uint32_t i = nodes[node].childCount; i > 0; i--) {
+                stack.push_back(childAt(node, i - 1));
+            }
+        }
+    }
+
+public:
+    static string normalizeKey(const string& text) {
+        string key;
+        key.reserve(text.size());
+        for (size_t i = 0; i < text.size();) {
+            unsigned char byte = static_cast<unsigned char>(text[i]);
+            if (byte < 0x80) {
+                key += static_cast<char>(byte >= 'A' && byte <= 'Z' ? byte + 32 : byte);
+                i++;
+                continue;
+            }
+
+            uint32_t codePoint;
+            size_t length = decodeUtf8(text, i, codePoint);
+            if (length == 0) {
+                key += static_cast<char>(byte);
+                i++;
+            } else {
+                appendFolded(key, codePoint);
+                i += length;
+            }
+        }
+        return key;
+    }
+
+    MusicTrie() : wastedEdges(0), wastedLabels(0), songCount(0), revision(0) {
+        nodes.push_back({0, 0, 0, 0, 0, -1, 0});
+        rankedSongs.resize(RANKED_PER_NODE);
+    }
+
+    void clear() {
+        uint64_t next = revision + 1;
+        *this = MusicTrie();
+        revision = next;
+    }
+
+    void bulkLoad(vector<Song> catalogue) {
+        if (songCount > 0) {
+            for (const Song& song : catalogue) insertSong(song.name, song.artist, song.metadata);
+            return;
+        }
+        clear();
+
+        size_t workers = max(1u, thread::hardware_concurrency());
+        vector<string> keys(catalogue.size());
+        vector<string> artistKeys(catalogue.size());
+        vector<thread> threads;
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() {
+                for (size_t i = w; i < catalogue.size(); i += workers) {
+                    parseSongAttributes(catalogue[i]);
+                    keys[i] = normalizeKey(catalogue[i].name);
+                    artistKeys[i] = normalizeKey(catalogue[i].artist);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        threads.clear();
+
+        vector<Partition> partitions(256);
+        vector<uint32_t> emptyKeys;
+        for (size_t i = 0; i < catalogue.size(); i++) {
+            if (keys[i].empty()) emptyKeys.push_back(static_cast<uint32_t>(i));
+            else partitions[static_cast<unsigned char>(keys[i][0])].order.push_back(static_cast<uint32_t>(i));
+        }
+
+        atomic<size_t> nextPartition(0);
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([&]() {
+                for (size_t p = nextPartition++; p < partitions.size(); p = nextPartition++) {
+                    vector<uint32_t>& order = partitions[p].order;
+                    if (order.empty()) continue;
+                    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                        int compared = keys[a].compare(keys[b]);
+                        return compared != 0 ? compared < 0 : artistKeys[a] < artistKeys[b];
+                    });
+
+                    size_t kept = 0;
+                    for (size_t i = 0; i < order.size(); i++) {
+                        if (i + 1 < order.size() && keys[order[i]] == keys[order[i + 1]] &&
+                            artistKeys[order[i]] == artistKeys[order[i + 1]]) {
+                            continue;
+                        }
+                        order[kept++] = order[i];
+                    }
+                    order.resize(kept);
+                    partitions[p].next.assign(kept, -1);
+                    buildRange(partitions[p], keys, 0, order.size(), 0);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        vector<uint32_t> rootChildren;
+        for (Partition& part : partitions) {
+            if (part.order.empty()) continue;
+            uint32_t nodeBase = static_cast<uint32_t>(nodes.size());
+            uint32_t edgeBase = static_cast<uint32_t>(childKeys.size());
+            uint32_t labelBase = static_cast<uint32_t>(labels.size());
+            uint32_t songBase = static_cast<uint32_t>(songs.size());
+
+            for (RadixNode node : part.nodes) {
+                node.labelOffset += labelBase;
+                node.childOffset += edgeBase;
+                if (node.songIndex >= 0) node.songIndex += songBase;
+                nodes.push_back(node);
+            }
+            childKeys.insert(childKeys.end(), part.childKeys.begin(), part.childKeys.end());
+            for (uint32_t child : part.childNodes) childNodes.push_back(child + nodeBase);
+            labels += part.labels;
+            for (uint32_t index : part.order) songs.push_back(move(catalogue[index]));
+            for (int32_t next : part.next) nextSong.push_back(next >= 0 ? next + static_cast<int32_t>(songBase) : -1);
+            rootChildren.push_back(nodeBase);
+            part = Partition();
+        }
+
+        nodes[0].childOffset = static_cast<uint32_t>(childKeys.size());
+        nodes[0].childCount = nodes[0].childCapacity = static_cast<uint32_t>(rootChildren.size());
+        for (uint32_t child : rootChildren) {
+            childKeys.push_back(static_cast<unsigned char>(labels[nodes[child].labelOffset]));
+            childNodes.push_back(child);
+        }
+
+        songCount = songs.size();
+        songPlays.assign(songCount, 0);
+        songRatings.resize(songCount);
+        rankedSongs.resize(nodes.size() * RANKED_PER_NODE);
+        for (size_t i = 0; i < songCount; i++) songRatings[i] = songs[i].rating;
+
+        thread artistBuilder([this]() {
+            unordered_map<string, vector<uint32_t>> grouped;
+            for (uint32_t i = 0; i < songs.size(); i++) grouped[normalizeKey(songs[i].artist)].push_back(i);
+            for (auto& entry : grouped) artistIndex.emplace(entry.first, move(entry.second));
+        });
+        thread genreBuilder([this]() {
+            for (uint32_t i = 0; i < songs.size(); i++) {
+                auto genre = songs[i].metadata.find("genre");
+                if (genre != songs[i].metadata.end()) genreIndex[normalizeKey(genre->second)].push_back(i);
+            }
+        });
+        thread ratingBuilder([this]() {
+            vector<pair<double, uint32_t>> ratings(songs.size());
+            for (uint32_t i = 0; i < songs.size(); i++) ratings[i] = {songRatings[i], i};
+            sort(ratings.begin(), ratings.end());
+            for (const auto& entry : ratings) ratingIndex.emplace_hint(ratingIndex.end(), entry);
+        });
+        rebuildAllRanked();
+        artistBuilder.join();
+        genreBuilder.join();
+        ratingBuilder.join();
+
+        for (uint32_t index : emptyKeys) {
+            insertSong(catalogue[index].name, catalogue[index].artist, catalogue[index].metadata);
+        }
+    }
+
+    bool saveImage(const string& path) const {
+        string image;
+        appendValue(image, IMAGE_MAGIC);
+        appendValue(image, static_cast<uint64_t>(songCount));
+        appendValue(image, static_cast<uint64_t>(wastedEdges));
+        appendArray(image, nodes);
+        appendArray(image, childKeys);
+        appendArray(image, childNodes);
+        appendArray(image, rankedSongs);
+        appendArray(image, songRatings);
+        appendArray(image, songPlays);
+        appendArray(image, nextSong);
+        appendArray(image, freeNodes);
+        appendArray(image, freeSongs);
+        appendString(image, labels);
+
+        string songData;
+        vector<uint64_t> songOffsets;
+        songOffsets.reserve(songs.size());
+        for (const Song& song : songs) {
+            songOffsets.push_back(songData.size());
+            appendString(songData, song.name);
+            appendString(songData, song.artist);
+            appendValue(songData, static_cast<uint32_t>(song.metadata.size()));
+            for (const auto& field : song.metadata) {
+                appendString(songData, field.first);
+                appendString(songData, field.second);
+            }
+        }
+        appendArray(image, songOffsets);
+        appendValue(image, static_cast<uint64_t>(songData.size()));
+        image += songData;
+
+        auto appendIndex = [&image](const auto& index) {
+            appendValue(image, static_cast<uint64_t>(index.size()));
+            for (const auto& entry : index) {
+                appendString(image, entry.first);
+                appendArray(image, entry.second);
+            }
+        };
+        appendIndex(artistIndex);
+        appendIndex(genreIndex);
+
+        return replaceFile(path, image);
+    }
+
+    bool loadImage(const string& path) {
+        FileView file;
+        if (!file.open(path) || file.data().empty()) return false;
+
+        ImageReader in = {file.data().data(), file.data().size(), 0, true};
+        MusicTrie loaded;
+        bool ok = in.value<uint64_t>() == IMAGE_MAGIC;
+        loaded.songCount = in.value<uint64_t>();
+        loaded.wastedEdges = in.value<uint64_t>();
+        in.array(loaded.nodes);
+        in.array(loaded.childKeys);
+        in.array(loaded.childNodes);
+        in.array(loaded.rankedSongs);
+        in.array(loaded.songRatings);
+        in.array(loaded.songPlays);
+        in.array(loaded.nextSong);
+        in.array(loaded.freeNodes);
+        in.array(loaded.freeSongs);
+        loaded.labels = in.text();
+
+        vector<uint64_t> songOffsets;
+        in.array(songOffsets);
+        uint64_t songBytes = in.value<uint64_t>();
+        uint64_t songTotal = songOffsets.size();
+        ok = ok && in.ok && songBytes <= in.size - in.position && songTotal == loaded.songRatings.size() &&
+             songTotal == loaded.songPlays.size() && songTotal == loaded.nextSong.size() && !loaded.nodes.empty() &&
+             loaded.rankedSongs.size() == loaded.nodes.size() * RANKED_PER_NODE;
+
+        if (ok) {
+            loaded.songs.resize(songTotal);
+            size_t workers = max(1u, thread::hardware_concurrency());
+            vector<char> decoded(workers, 1);
+            vector<thread> threads;
+            for (size_t w = 0; w < workers; w++) {
+                threads.emplace_back([&, w]() {
+                    ImageReader songIn = {in.data + in.position, songBytes, 0, true};
+                    for (size_t i = songTotal * w / workers; i < songTotal * (w + 1) / workers && songIn.ok; i++) {
+                        if (songOffsets[i] >= songBytes) {
+                            songIn.ok = false;
+                            break;
+                        }
+                        songIn.position = songOffsets[i];
+                        Song& song = loaded.songs[i];
+                        song.name = songIn.text();
+                        song.artist = songIn.text();
+                        uint32_t fields = songIn.value<uint32_t>();
+                        for (uint32_t f = 0; f < fields && songIn.ok; f++) {
+                            string field = songIn.text();
+                            song.metadata.emplace_hint(song.metadata.end(), move(field), songIn.text());
+                        }
+                        parseSongAttributes(song);
+                    }
+                    decoded[w] = songIn.ok;
+                });
+            }
+            for (auto& t : threads) t.join();
+            in.position += songBytes;
+            ok = find(decoded.begin(), decoded.end(), 0) == decoded.end();
+        }
+
+        for (int which = 0; ok && which < 2; which++) {
+            uint64_t entries = in.value<uint64_t>();
+            for (uint64_t e = 0; e < entries && in.ok; e++) {
+                string key = in.text();
+                vector<uint32_t> ids;
+                in.array(ids);
+                if (which == 0) loaded.artistIndex.emplace_hint(loaded.artistIndex.end(), move(key), move(ids));
+                else loaded.genreIndex.emplace(move(key), move(ids));
+            }
+            ok = in.ok;
+        }
+        file.close();
+
+        uint64_t labelBytes = 0;
+        for (size_t i = 0; ok && i < loaded.nodes.size(); i++) {
+            const RadixNode& node = loaded.nodes[i];
+            labelBytes += node.labelLength;
+            ok = node.childCount <= node.childCapacity &&
+                 static_cast<uint64_t>(node.childOffset) + node.childCapacity <= loaded.childKeys.size() &&
+                 static_cast<uint64_t>(node.labelOffset) + node.labelLength <= loaded.labels.size() &&
+                 node.songIndex < static_cast<int64_t>(songTotal) && node.rankedCount <= RANKED_PER_NODE;
+        }
+        ok = ok && loaded.childKeys.size() == loaded.childNodes.size();
+        for (size_t i = 0; ok && i < loaded.childNodes.size(); i++) ok = loaded.childNodes[i] < loaded.nodes.size();
+        for (size_t i = 0; ok && i < loaded.nextSong.size(); i++) {
+            ok = loaded.nextSong[i] < static_cast<int64_t>(songTotal) && loaded.nextSong[i] != static_cast<int32_t>(i);
+        }
+        if (!ok) return false;
+
+        vector<char> reached(loaded.nodes.size(), 0), live(songTotal, 0);
+        vector<uint32_t> stack = {0};
+        size_t liveSongs = 0;
+        reached[0] = 1;
+        while (ok && !stack.empty()) {
+            const RadixNode& node = loaded.nodes[stack.back()];
+            stack.pop_back();
+            for (int32_t song = node.songIndex; ok && song >= 0; song = loaded.nextSong[song]) {
+                ok = !live[song];
+                live[song] = 1;
+                liveSongs++;
+            }
+            for (uint32_t c = 0; ok && c < node.childCount; c++) {
+                uint32_t child = loaded.childNodes[node.childOffset + c];
+                ok = !reached[child];
+                reached[child] = 1;
+                stack.push_back(child);
+            }
+        }
+        for (size_t i = 0; ok && i < loaded.rankedSongs.size(); i++) {
+            ok = i % RANKED_PER_NODE >= loaded.nodes[i / RANKED_PER_NODE].rankedCount ||
+                 (loaded.rankedSongs[i] < songTotal && live[loaded.rankedSongs[i]]);
+        }
+        for (size_t i = 0; ok && i < loaded.freeNodes.size(); i++) {
+            uint32_t index = loaded.freeNodes[i];
+            ok = index < reached.size() && !reached[index];
+            if (ok) reached[index] = 1;
+        }
+        vector<char> freed(songTotal, 0);
+        for (size_t i = 0; ok && i < loaded.freeSongs.size(); i++) {
+            uint32_t index = loaded.freeSongs[i];
+            ok = index < songTotal && !live[index] && !freed[index];
+            if (ok) freed[index] = 1;
+        }
+        ok = ok && liveSongs == loaded.songCount && liveSongs + loaded.freeSongs.size() == songTotal;
+        if (!ok) return false;
+
+        vector<pair<double, uint32_t>> ratings;
+        for (uint32_t i = 0; i < live.size(); i++) {
+            if (live[i]) ratings.push_back({loaded.songRatings[i], i});
+        }
+        sort(ratings.begin(), ratings.end());
+        for (const auto& entry : ratings) loaded.ratingIndex.emplace_hint(loaded.ratingIndex.end(), entry);
+
+        loaded.wastedLabels = loaded.labels.size() - min<uint64_t>(labelBytes, loaded.labels.size());
+        loaded.revision = revision + 1;
+        *this = move(loaded);
+        return true;
+    }
+
+    void insertSong(const string& songName, const string& artist, const map<string, string>& metadata = {}) {
+        string key = normalizeKey(songName);
+        vector<uint32_t> path = {0};
+        uint32_t node = 0;
+        size_t i = 0;
+
+        while (i < key.size()) {
+            int position = findChild(node, static_cast<unsigned char>(key[i]));
+            if (position < 0) {
+                uint32_t leaf = newNode(storeLabel(key, i), static_cast<uint32_t>(key.size() - i));
+                addChild(node, leaf);
+                node = leaf;
+                path.push_back(node);
+                i = key.size();
+                break;
+            }
+
+            uint32_t child = childAt(node, position);
+            size_t matched = commonPrefix(nodes[child], key, i);
+            if (matched < nodes[child].labelLength) {
+                uint32_t middle = newNode(nodes[child].labelOffset, static_cast<uint32_t>(matched));
+                nodes[child].labelOffset += matched;
+                nodes[child].labelLength -= matched;
+                childNodes[nodes[node].childOffset + position] = middle;
+                addChild(middle, child);
+                copyRanked(child, middle);
+                child = middle;
+            }
+            node = child;
+            path.push_back(node);
+            i += matched;
+        }
+
+        Song song = {songName, artist, metadata};
+        parseSongAttributes(song);
+        revision++;
+        string artistKey = normalizeKey(artist);
+        int32_t previous = -1;
+        int32_t current = nodes[node].songIndex;
+        int compared = 1;
+        while (current >= 0 && (compared = normalizeKey(songs[current].artist).compare(artistKey)) < 0) {
+            previous = current;
+            current = nextSong[current];
+        }
+
+        if (current >= 0 && compared == 0) {
+            uint32_t index = static_cast<uint32_t>(current);
+            unindexSong(index);
+            songs[index] = song;
+            songRatings[index] = song.rating;
+            indexSong(index);
+            for (size_t p = path.size(); p > 0; p--) rebuildRanked(path[p - 1]);
+            return;
+        }
+
+        uint32_t index;
+        if (!freeSongs.empty()) {
+            index = freeSongs.back();
+            freeSongs.pop_back();
+            songs[index] = song;
+        } else {
+            index = static_cast<uint32_t>(songs.size());
+            songs.push_back(song);
+            nextSong.push_back(-1);
+            songRatings.push_back(0);
+            songPlays.push_back(0);
+        }
+        songRatings[index] = song.rating;
+        songPlays[index] = 0;
+        nextSong[index] = current;
+        if (previous < 0) nodes[node].songIndex = static_cast<int32_t>(index);
+        else nextSong[previous] = static_cast<int32_t>(index);
+        songCount++;
+        indexSong(index);
+
+        for (uint32_t n : path) offerRanked(n, index);
+    }
+
+    vector<Song> searchPrefix(const string& prefix) {
+        vector<Song> result;
+        int64_t node = locate(normalizeKey(prefix), true);
+        if (node < 0) return result;
+
+        forEachSong(static_cast<uint32_t>(node), [&result](const Song& song) { result.push_back(song); });
+        return result;
+    }
+
+    vector<const Song*> autoComplete(const string& prefix, int limit) const {
+        vector<const Song*> result;
+        int64_t found = locate(normalizeKey(prefix), true);
+        if (found < 0 || limit <= 0) return result;
+
+        uint32_t start = static_cast<uint32_t>(found);
+        const uint32_t* ranked = rankedAt(start);
+        if (static_cast<uint32_t>(limit) <= RANKED_PER_NODE || nodes[start].rankedCount < RANKED_PER_NODE) {
+            uint32_t count = min(static_cast<uint32_t>(limit), nodes[start].rankedCount);
+            for (uint32_t i = 0; i < count; i++) result.push_back(&songs[ranked[i]]);
+            return result;
+        }
+
+        struct Candidate {
+            uint32_t song;
+            uint32_t node;
+            bool expand;
+        };
+        auto worse = [this](const Candidate& a, const Candidate& b) { return ranksBefore(b.song, a.song); };
+        priority_queue<Candidate, vector<Candidate>, decltype(worse)> frontier(worse);
+        frontier.push({ranked[0], start, true});
+
+        result.reserve(limit);
+        while (!frontier.empty() && result.size() < static_cast<size_t>(limit)) {
+            Candidate next = frontier.top();
+            frontier.pop();
+            if (!next.expand) {
+                result.push_back(&songs[next.song]);
+                continue;
+            }
+
+            const RadixNode& node = nodes[next.node];
+            for (int32_t song = node.songIndex; song >= 0; song = nextSong[song]) {
+                frontier.push({static_cast<uint32_t>(song), next.node, false});
+            }
+            for (uint32_t i = 0; i < node.childCount; i++) {
+                uint32_t child = childAt(next.node, i);
+                if (nodes[child].rankedCount > 0) frontier.push({rankedAt(child)[0], child, true});
+            }
+        }
+        return result;
+    }
+
+    vector<FuzzySongMatch> fuzzySearch(const string& query, int maxDistance = 2, int limit = 10,
+                                       size_t* visitedNodes = nullptr) const {
+        string key = normalizeKey(query);
+        maxDistance = max(0, min(maxDistance, 2));
+        size_t width = key.size() + 1;
+
+        vector<int> rows(width);
+        for (size_t j = 0; j < width; j++) rows[j] = static_cast<int>(j);
+
+        vector<pair<int, uint32_t>> found;
+        vector<pair<uint32_t, uint32_t>> stack = {{0, 0}};
+        size_t visited = 0;
+        while (!stack.empty()) {
+            uint32_t node = stack.back().first;
+            uint32_t depth = stack.back().second;
+            stack.pop_back();
+            visited++;
+
+            const RadixNode& n = nodes[node];
+            bool alive = true;
+            for (uint32_t c = 0; c < n.labelLength && alive; c++) {
+                if (rows.size() < (depth + 2) * width) rows.resize((depth + 2) * width);
+                const int* previous = rows.data() + depth * width;
+                int* current = rows.data() + (depth + 1) * width;
+                char letter = labels[n.labelOffset + c];
+
+                current[0] = previous[0] + 1;
+                int best = current[0];
+                for (size_t j = 1; j < width; j++) {
+                    int cost = key[j - 1] == letter ? 0 : 1;
+                    current[j] = min(min(current[j - 1], previous[j]) + 1, previous[j - 1] + cost);
+                    best = min(best, current[j]);
+                }
+                depth++;
+                alive = best <= maxDistance;
+            }
+            if (!alive) continue;
+
+            int distance = rows[depth * width + key.size()];
+            for (int32_t song = n.songIndex; song >= 0 && distance <= maxDistance; song = nextSong[song]) {
+                found.push_back({distance, static_cast<uint32_t>(song)});
+            }
+            for (uint32_t i = n.childCount; i > 0; i--) stack.push_back({childAt(node, i - 1), depth});
+        }
+        if (visitedNodes) *visitedNodes = visited;
+
+        size_t keep = min(found.size(), static_cast<size_t>(max(limit, 0)));
+        partial_sort(found.begin(), found.begin() + keep, found.end(),
+                     [this](const pair<int, uint32_t>& a, const pair<int, uint32_t>& b) {
+                         if (a.first != b.first) return a.first < b.first;
+                         return ranksBefore(a.second, b.second);
+                     });
+
+        vector<FuzzySongMatch> result;
+        result.reserve(keep);
+        for (size_t i = 0; i < keep; i++) result.push_back({&songs[found[i].second], found[i].first});
+        return result;
+    }
+
+    bool recordPlay(const string& songName, const string& artist = "", uint64_t plays = 1) {
+        vector<uint32_t> path;
+        if (!findPath(normalizeKey(songName), path)) return false;
+
+        int32_t song = nodes[path.back()].songIndex;
+        if (!artist.empty()) {
+            string artistKey = normalizeKey(artist);
+            while (song >= 0 && normalizeKey(songs[song].artist) != artistKey) song = nextSong[song];
+            if (song < 0) return false;
+        }
+
+        uint32_t index = static_cast<uint32_t>(song);
+        songPlays[index] += plays;
+        for (size_t p = path.size(); p > 0; p--) offerRanked(path[p - 1], index);
+        return true;
+    }
+
+    void resetPlays() {
+        fill(songPlays.begin(), songPlays.end(), 0);
+        rebuildAllRanked();
+    }
+
+    bool deleteSong(const string& songName, const string& artist = "") {
+        string key = normalizeKey(songName);
+        vector<pair<uint32_t, int>> path;
+        uint32_t node = 0;
+        size_t i = 0;
+
+        while (i < key.size()) {
+            int position = findChild(node, static_cast<unsigned char>(key[i]));
+            if (position < 0) return false;
+
+            path.push_back({node, position});
+            node = childAt(node, position);
+            size_t matched = commonPrefix(nodes[node], key, i);
+            if (matched < nodes[node].labelLength) return false;
+            i += matched;
+        }
+
+        string artistKey = normalizeKey(artist);
+        vector<uint32_t> removed;
+        int32_t previous = -1;
+        for (int32_t song = nodes[node].songIndex; song >= 0;) {
+            int32_t next = nextSong[song];
+            if (artist.empty() || normalizeKey(songs[song].artist) == artistKey) {
+                if (previous < 0) nodes[node].songIndex = next;
+                else nextSong[previous] = next;
+
+                unindexSong(static_cast<uint32_t>(song));
+                songs[song] = Song();
+                nextSong[song] = -1;
+                freeSongs.push_back(static_cast<uint32_t>(song));
+                removed.push_back(static_cast<uint32_t>(song));
+                songCount--;
+            } else {
+                previous = song;
+            }
+            song = next;
+        }
+        if (removed.empty()) return false;
+        revision++;
+
+        auto containsRemoved = [&](uint32_t n) {
+            for (uint32_t index : removed) {
+                if (rankedContains(n, index)) return true;
+            }
+            return false;
+        };
+
+        if (path.empty()) {
+            rebuildRanked(0);
+            return true;
+        }
+
+        uint32_t parent = path.back().first;
+        if (nodes[node].songIndex >= 0) {
+            rebuildRanked(node);
+        } else if (nodes[node].childCount == 0) {
+            removeChild(parent, path.back().second);
+            wastedEdges += nodes[node].childCapacity;
+            releaseNode(node);
+            if (parent != 0 && nodes[parent].songIndex < 0 && nodes[parent].childCount == 1) {
+                mergeWithOnlyChild(parent);
+            }
+        } else {
+            if (nodes[node].childCount == 1) mergeWithOnlyChild(node);
+            rebuildRanked(node);
+        }
+
+        for (size_t p = path.size(); p > 0; p--) {
+            uint32_t ancestor = path[p - 1].first;
+            if (containsRemoved(ancestor)) rebuildRanked(ancestor);
+        }
+        compactEdges();
+        compactLabels();
+        return true;
+    }
+
+    vector<Song> getAllSongs() {
+        vector<Song> result;
+        result.reserve(songCount);
+        forEachSong(0, [&result](const Song& song) { result.push_back(song); });
+        return result;
+    }
+
+    vector<const Song*> searchByArtist(const string& artistName) const {
+        auto it = artistIndex.find(normalizeKey(artistName));
+        return it == artistIndex.end() ? vector<const Song*>() : resolve(it->second);
+    }
+
+    vector<const Song*> searchByArtistPrefix(const string& prefix) const {
+        string key = normalizeKey(prefix);
+        vector<const Song*> result;
+        for (auto it = artistIndex.lower_bound(key);
+             it != artistIndex.end() && it->first.compare(0, key.size(), key) == 0; ++it) {
+            for (uint32_t index : it->second) result.push_back(&songs[index]);
+        }
+        return result;
+    }
+
+    vector<const Song*> searchByGenre(const string& genre) const {
+        auto it = genreIndex.find(normalizeKey(genre));
+        return it == genreIndex.end() ? vector<const Song*>() : resolve(it->second);
+    }
+
+    vector<const Song*> searchByRating(double minRating, double maxRating = numeric_limits<double>::max()) const {
+        vector<const Song*> result;
+        auto first = ratingIndex.lower_bound({minRating, 0});
+        auto last = ratingIndex.upper_bound({maxRating, numeric_limits<uint32_t>::max()});
+        for (auto it = last; it != first;) {
+            --it;
+            result.push_back(&songs[it->second]);
+        }
+        return result;
+    }
+
+    bool hasPrefix(const string& prefix) const {
+        return locate(normalizeKey(prefix), true) >= 0;
+    }
+
+    size_t size() const {
+        return songCount;
+    }
+
+    uint64_t getRevision() const {
+        return revision;
+    }
+
+    size_t nodeCount() const {
+        return nodes.size() - freeNodes.size();
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(MusicTrie) + nodes.capacity() * sizeof(RadixNode) + childKeys.capacity() +
+                       childNodes.capacity() * sizeof(uint32_t) + stringHeapBytes(labels) +
+                       songs.capacity() * sizeof(Song) + songRatings.capacity() * sizeof(double) +
+                       songPlays.capacity() * sizeof(uint64_t) + nextSong.capacity() * sizeof(int32_t) +
+                       rankedSongs.capacity() * sizeof(uint32_t) + freeNodes.capacity() * sizeof(uint32_t) +
+                       freeSongs.capacity() * sizeof(uint32_t) + treeNodeBytes(artistIndex) +
+                       hashTableBytes(genreIndex) + treeNodeBytes(ratingIndex);
+        for (const Song& song : songs) bytes += songHeapBytes(song);
+        for (const auto& entry : artistIndex) bytes += stringHeapBytes(entry.first) + entry.second.capacity() * sizeof(uint32_t);
+        for (const auto& entry : genreIndex) bytes += stringHeapBytes(entry.first) + entry.second.capacity() * sizeof(uint32_t);
+        return bytes;
+    }
+};
+
+class LegacyPointerTrie {
+private:
+    TrieNode* root;
+
+public:
+    LegacyPointerTrie() : root(new TrieNode()) {}
+
+    void insertSong(const string& songName, const string& artist, const map<string, string>& metadata = {}) {
+        TrieNode* node = root;
+        string lowerName = songName;
+        transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+
+        for (char c : lowerName) {
+            if (node->children.find(c) == node->children.end()) {
+                node->children[c] = new TrieNode();
+            }
+            node = node->children[c];
+        }
+
+        node->isEnd = true;
+        delete node->songData;
+        node->songData = new Song{songName, artist, metadata};
+    }
+
+    bool containsPrefix(const string& prefix) const {
+        TrieNode* node = root;
+        for (char c : prefix) {
+            auto it = node->children.find(c);
+            if (it == node->children.end()) return false;
+            node = it->second;
+        }
+        return true;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(LegacyPointerTrie);
+        vector<const TrieNode*> stack = {root};
+        while (!stack.empty()) {
+            const TrieNode* node = stack.back();
+            stack.pop_back();
+            bytes += sizeof(TrieNode) + hashTableBytes(node->children);
+            if (node->songData) bytes += sizeof(Song) + songHeapBytes(*node->songData);
+            for (const auto& child : node->children) stack.push_back(child.second);
+        }
+        return bytes;
+    }
+
+    ~LegacyPointerTrie() {
+        delete root;
+    }
+};
+
+string benchmarkMusicTrie(size_t songCount, size_t lookups = 200000) {
+    mt19937 rng(42);
+    const string words[] = {"love", "night", "summer", "dance", "heart", "road", "fire", "dream",
+                            "blue", "light", "river", "city", "rain", "gold", "wild", "home"};
+    vector<string> titles;
+    titles.reserve(songCount);
+    for (size_t i = 0; i < songCount; i++) {
+        titles.push_back(words[rng() % 16] + " " + words[rng() % 16] + " " + to_string(rng() % 100000));
+    }
+    vector<string> prefixes;
+    for (size_t i = 0; i < lookups; i++) {
+        const string& title = titles[rng() % titles.size()];
+        prefixes.push_back(title.substr(0, 3 + rng() % (title.size() - 2)));
+    }
+
+    auto measure = [&](auto& trie, auto&& lookup) {
+        auto started = chrono::steady_clock::now();
+        for (const string& title : titles) trie.insertSong(title, "Benchmark Artist");
+        double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        size_t bytes = trie.memoryUsage();
+
+        started = chrono::steady_clock::now();
+        size_t hits = 0;
+        for (const string& prefix : prefixes) hits += lookup(trie, prefix);
+        double lookupSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        return "build " + formatNumber(buildSeconds * 1000) + " ms | memory " +
+               formatNumber(bytes / 1048576.0) + " MiB | " + to_string(prefixes.size()) + " lookups " +
+               formatNumber(lookupSeconds * 1000) + " ms (" + to_string(hits) + " hits)";
+    };
+
+    string report = "Songs: " + to_string(songCount) + "\n";
+    {
+        LegacyPointerTrie legacy;
+        report += "Pointer trie: " + measure(legacy, [](LegacyPointerTrie& t, const string& p) {
+            return t.containsPrefix(p) ? 1 : 0;
+        }) + "\n";
+    }
+    {
+        MusicTrie radix;
+        report += "Radix trie:   " + measure(radix, [](MusicTrie& t, const string& p) {
+            return t.hasPrefix(p) ? 1 : 0;
+        }) + "\n";
+    }
+    {
+        vector<Song> catalogue;
+        catalogue.reserve(titles.size());
+        for (const string& title : titles) catalogue.push_back({title, "Benchmark Artist", {}});
+        MusicTrie bulk;
+        auto started = chrono::steady_clock::now();
+        bulk.bulkLoad(move(catalogue));
+        report += "Bulk load:    build " +
+                  formatNumber(chrono::duration<double>(chrono::steady_clock::now() - started).count() * 1000) +
+                  " ms | memory " + formatNumber(bulk.memoryUsage() / 1048576.0) + " MiB | " +
+                  to_string(bulk.nodeCount()) + " nodes\n";
+    }
+    return report;
+}
+
+
+class CountMinSketch {
+private:
+    static constexpr size_t MAX_DEPTH = 32;
+    static constexpr size_t MAX_CELLS = size_t(1) << 23;
+    static constexpr size_t LOCK_STRIPES = 64;
+
+    size_t width;
+    size_t depth;
+    uint64_t seed;
+    vector<atomic<uint64_t>> cells;
+    atomic<uint64_t> total;
+    unique_ptr<mutex[]> stripes;
+
+    uint64_t hashKey(const string& key) const {
+        uint64_t hash = 14695981039346656037ULL ^ seed;
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    void cellsFor(const string& key, size_t* positions) const {
+        uint64_t hash = hashKey(key);
+        uint64_t first = hash & 0xffffffffULL;
+        uint64_t second = (hash >> 32) | 1;
+        for (size_t row = 0; row < depth; row++) {
+            positions[row] = row * width + (first + row * second) % width;
+        }
+    }
+
+public:
+    CountMinSketch(size_t width, size_t depth, uint64_t seed = 0x7472617665ULL)
+        : width(min(max<size_t>(width, 1), MAX_CELLS / min(max<size_t>(depth, 1), MAX_DEPTH))),
+          depth(min(max<size_t>(depth, 1), MAX_DEPTH)), seed(seed),
+          cells(this->width * this->depth), total(0), stripes(new mutex[LOCK_STRIPES]) {
+        for (auto& cell : cells) cell.store(0, memory_order_relaxed);
+    }
+
+    static bool supportsErrorBounds(double epsilon, double delta) {
+        if (!(epsilon > 0 && epsilon < 1 && delta > 0 && delta < 1)) return false;
+        double rows = ceil(log(1.0 / delta));
+        return rows <= MAX_DEPTH && ceil(exp(1.0) / epsilon) * max(rows, 1.0) <= MAX_CELLS;
+    }
+
+    static CountMinSketch withErrorBounds(double epsilon, double delta) {
+        epsilon = min(max(epsilon, 1e-7), 1.0);
+        delta = min(max(delta, 1e-9), 0.5);
+        return CountMinSketch(static_cast<size_t>(ceil(exp(1.0) / epsilon)),
+                              static_cast<size_t>(ceil(log(1.0 / delta))));
+    }
+
+    uint64_t add(const string& key, uint64_t count = 1) {
+        size_t positions[MAX_DEPTH];
+        cellsFor(key, positions);
+
+        lock_guard<mutex> guard(stripes[hashKey(key) % LOCK_STRIPES]);
+        uint64_t minimum = numeric_limits<uint64_t>::max();
+        for (size_t row = 0; row < depth; row++) {
+            minimum = min(minimum, cells[positions[row]].load(memory_order_relaxed));
+        }
+
+        uint64_t target = minimum + count;
+        for (size_t row = 0; row < depth; row++) {
+            atomic<uint64_t>& cell = cells[positions[row]];
+            uint64_t current = cell.load(memory_order_relaxed);
+            while (current < target && !cell.compare_exchange_weak(current, target, memory_order_relaxed)) {
+            }
+        }
+        total.fetch_add(count, memory_order_relaxed);
+        return target;
+    }
+
+    uint64_t estimate(const string& key) const {
+        size_t positions[MAX_DEPTH];
+        cellsFor(key, positions);
+
+        uint64_t minimum = numeric_limits<uint64_t>::max();
+        for (size_t row = 0; row < depth; row++) {
+            minimum = min(minimum, cells[positions[row]].load(memory_order_relaxed));
+        }
+        return minimum;
+    }
+
+    bool merge(const CountMinSketch& other) {
+        if (other.width != width || other.depth != depth || other.seed != seed) return false;
+        for (size_t i = 0; i < cells.size(); i++) {
+            cells[i].fetch_add(other.cells[i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        total.fetch_add(other.total.load(memory_order_relaxed), memory_order_relaxed);
+        return true;
+    }
+
+    void clear() {
+        for (auto& cell : cells) cell.store(0, memory_order_relaxed);
+        total.store(0, memory_order_relaxed);
+    }
+
+    uint64_t totalCount() const {
+        return total.load(memory_order_relaxed);
+    }
+
+    double epsilon() const {
+        return exp(1.0) / width;
+    }
+
+    double confidence() const {
+        return 1.0 - exp(-static_cast<double>(depth));
+    }
+
+    double errorBound() const {
+        return epsilon() * totalCount();
+    }
+
+    size_t memoryUsage() const {
+        return cells.size() * sizeof(uint64_t);
+    }
+};
+
+class SlidingWindowCounter {
+private:
+    struct Bucket {
+        int64_t epoch;
+        unordered_map<uint32_t, uint64_t> counts;
+    };
+
+    int64_t bucketSeconds;
+    vector<Bucket> buckets;
+    int64_t latestEpoch;
+    unordered_map<uint32_t, uint64_t> totals;
+    set<pair<uint64_t, uint32_t>> ranking;
+
+    int64_t epochOf(int64_t timestamp) const {
+        return timestamp >= 0 ? timestamp / bucketSeconds : (timestamp - bucketSeconds + 1) / bucketSeconds;
+    }
+
+    void adjust(uint32_t songId, uint64_t added, uint64_t removed) {
+        auto it = totals.find(songId);
+        uint64_t before = it == totals.end() ? 0 : it->second;
+        uint64_t after = before + added - removed;
+        if (after == 0) {
+            if (it != totals.end()) totals.erase(it);
+            ranking.erase({before, songId});
+            return;
+        }
+
+        if (it == totals.end()) {
+            totals.emplace(songId, after);
+            ranking.insert({after, songId});
+            return;
+        }
+        it->second = after;
+        auto entry = ranking.extract({before, songId});
+        entry.value().first = after;
+        ranking.insert(move(entry));
+    }
+
+    void advance(int64_t epoch) {
+        int64_t size = static_cast<int64_t>(buckets.size());
+        if (latestEpoch != numeric_limits<int64_t>::min() && epoch <= latestEpoch) return;
+
+        int64_t first = latestEpoch == numeric_limits<int64_t>::min() ? epoch - size + 1
+                                                                       : max(latestEpoch + 1, epoch - size + 1);
+        for (int64_t e = first; e <= epoch; e++) {
+            Bucket& bucket = buckets[((e % size) + size) % size];
+            for (const auto& entry : bucket.counts) adjust(entry.first, 0, entry.second);
+            bucket.counts.clear();
+            bucket.epoch = e;
+        }
+        latestEpoch = epoch;
+    }
+
+public:
+    SlidingWindowCounter(int64_t bucketSeconds, size_t bucketCount)
+        : bucketSeconds(max<int64_t>(bucketSeconds, 1)), buckets(max<size_t>(bucketCount, 1)),
+          latestEpoch(numeric_limits<int64_t>::min()) {
+        for (Bucket& bucket : buckets) bucket.epoch = numeric_limits<int64_t>::min();
+    }
+
+    void add(uint32_t songId, uint64_t count, int64_t timestamp) {
+        int64_t epoch = epochOf(timestamp);
+        advance(epoch);
+        if (epoch <= latestEpoch - static_cast<int64_t>(buckets.size())) return;
+
+        int64_t size = static_cast<int64_t>(buckets.size());
+        buckets[((epoch % size) + size) % size].counts[songId] += count;
+        adjust(songId, count, 0);
+    }
+
+    vector<pair<uint32_t, uint64_t>> top(int k, int64_t now) {
+        advance(epochOf(now));
+        vector<pair<uint32_t, uint64_t>> result;
+        for (auto it = ranking.rbegin(); it != ranking.rend() && result.size() < static_cast<size_t>(max(k, 0)); ++it) {
+            result.push_back({it->second, it->first});
+        }
+        return result;
+    }
+
+    uint64_t count(uint32_t songId, int64_t now) {
+        advance(epochOf(now));
+        auto it = totals.find(songId);
+        return it == totals.end() ? 0 : it->second;
+    }
+
+    bool contains(uint32_t songId) const {
+        return totals.count(songId) > 0;
+    }
+
+    template <typename Visit>
+    void forEachCount(Visit visit) const {
+        for (const Bucket& bucket : buckets) {
+            if (bucket.epoch == numeric_limits<int64_t>::min()) continue;
+            for (const auto& entry : bucket.counts) visit(entry.first, entry.second, bucket.epoch * bucketSeconds);
+        }
+    }
+
+    int64_t spanSeconds() const {
+        return bucketSeconds * static_cast<int64_t>(buckets.size());
+    }
+
+    void clear() {
+        for (Bucket& bucket : buckets) {
+            bucket.counts.clear();
+            bucket.epoch = numeric_limits<int64_t>::min();
+        }
+        latestEpoch = numeric_limits<int64_t>::min();
+        totals.clear();
+        ranking.clear();
+    }
+};
+
+class ForwardDecayScores {
+private:
+    double lambda;
+    int64_t landmark;
+    bool started;
+    unordered_map<uint32_t, double> logWeights;
+    set<pair<double, uint32_t>> ranking;
+
+    double logAge(int64_t timestamp) const {
+        return lambda * static_cast<double>(timestamp - landmark);
+    }
+
+    void merge(uint32_t songId, double contribution) {
+        auto it = logWeights.find(songId);
+        if (it == logWeights.end()) {
+            it = logWeights.emplace(songId, contribution).first;
+            ranking.insert({it->second, songId});
+        } else {
+            auto entry = ranking.extract({it->second, songId});
+            double high = max(it->second, contribution);
+            it->second = high + log1p(exp(min(it->second, contribution) - high));
+            entry.value().first = it->second;
+            ranking.insert(move(entry));
+        }
+    }
+
+public:
+    explicit ForwardDecayScores(double halfLifeSeconds)
+        : lambda(log(2.0) / max(halfLifeSeconds, 1.0)), landmark(0), started(false) {}
+
+    void add(uint32_t songId, uint64_t count, int64_t timestamp) {
+        if (!started) {
+            landmark = timestamp;
+            started = true;
+        }
+
+        merge(songId, log(static_cast<double>(count)) + logAge(timestamp));
+
+        while (ranking.size() > 1 && ranking.begin()->first - logAge(timestamp) < log(1e-6)) {
+            logWeights.erase(ranking.begin()->second);
+            ranking.erase(ranking.begin());
+        }
+    }
+
+    vector<pair<uint32_t, double>> top(int k, int64_t now) const {
+        vector<pair<uint32_t, double>> result;
+        for (auto it = ranking.rbegin(); it != ranking.rend() && result.size() < static_cast<size_t>(max(k, 0)); ++it) {
+            result.push_back({it->second, exp(it->first - logAge(now))});
+        }
+        return result;
+    }
+
+    double score(uint32_t songId, int64_t now) const {
+        auto it = logWeights.find(songId);
+        return it == logWeights.end() ? 0.0 : exp(it->second - logAge(now));
+    }
+
+    bool contains(uint32_t songId) const {
+        return logWeights.count(songId) > 0;
+    }
+
+    int64_t landmarkTime() const {
+        return landmark;
+    }
+
+    template <typename Visit>
+    void forEachScore(Visit visit) const {
+        for (const auto& entry : logWeights) visit(entry.first, entry.second);
+    }
+
+    void restore(uint32_t songId, double logWeight, int64_t savedLandmark) {
+        if (!started) {
+            landmark = savedLandmark;
+            started = true;
+        }
+        merge(songId, logWeight + lambda * static_cast<double>(savedLandmark - landmark));
+    }
+
+    void clear() {
+        started = false;
+        logWeights.clear();
+        ranking.clear();
+    }
+};
+
+class PlayEventLog {
+private:
+    string basePath;
+    uint64_t generation;
+    FileHandle fd;
+    FileHandle retiredFd;
+    string retiredBuffer;
+    uint64_t retiredRecords;
+    mutex bufferLock;
+    condition_variable wake;
+    condition_variable durable;
+    string buffer;
+    uint64_t appendedRecords;
+    uint64_t durableRecords;
+    uint64_t segmentBytes;
+    bool stopping;
+    bool failed;
+    thread writer;
+
+    static void appendRaw(string& out, const void* data, size_t size) {
+        out.append(static_cast<const char*>(data), size);
+    }
+
+    void writerLoop() {
+        unique_lock<mutex> lock(bufferLock);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || !buffer.empty() || retiredFd != NO_FILE; });
+            if (retiredFd != NO_FILE) {
+                string batch;
+                batch.swap(retiredBuffer);
+                uint64_t records = retiredRecords;
+                FileHandle target = retiredFd;
+                lock.unlock();
+
+                bool ok = writeAll(target, batch) && syncFile(target, true);
+                closeFile(target);
+                syncDirectoryOf(basePath);
+
+                lock.lock();
+                if (!ok) failed = true;
+                retiredFd = NO_FILE;
+                durableRecords = records;
+                durable.notify_all();
+                continue;
+            }
+            if (buffer.empty()) break;
+
+            string batch;
+            batch.swap(buffer);
+            uint64_t records = appendedRecords;
+            FileHandle target = fd;
+            lock.unlock();
+
+            bool ok = writeAll(target, batch) && syncFile(target, true);
+
+            lock.lock();
+            if (!ok) failed = true;
+            durableRecords = records;
+            durable.notify_all();
+        }
+    }
+
+public:
+    PlayEventLog()
+        : generation(0), fd(NO_FILE), retiredFd(NO_FILE), retiredRecords(0), appendedRecords(0), durableRecords(0),
+          segmentBytes(0), stopping(false), failed(false) {}
+
+    ~PlayEventLog() {
+        close();
+    }
+
+    static uint32_t crc32(const char* data, size_t size) {
+        static const vector<uint32_t> table = []() {
+            vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; bit++) value = (value >> 1) ^ ((value & 1) ? 0xEDB88320u : 0);
+                entries[i] = value;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    static string segmentPath(const string& base, uint64_t segment) {
+        return base + "." + to_string(segment) + ".log";
+    }
+
+    static bool newestSegment(const string& base, uint64_t& newest) {
+        size_t slash = base.find_last_of('/');
+        string directory = slash == string::npos ? "." : (slash == 0 ? "/" : base.substr(0, slash));
+        string prefix = (slash == string::npos ? base : base.substr(slash + 1)) + ".";
+
+        bool found = false;
+        for (const string& name : listDirectory(directory)) {
+            if (name.size() <= prefix.size() + 4 || name.compare(0, prefix.size(), prefix) != 0 ||
+                name.compare(name.size() - 4, 4, ".log") != 0) continue;
+            string digits = name.substr(prefix.size(), name.size() - prefix.size() - 4);
+            if (digits.find_first_not_of("0123456789") != string::npos) continue;
+            uint64_t segment = strtoull(digits.c_str(), nullptr, 10);
+            if (!found || segment > newest) newest = segment;
+            found = true;
+        }
+        return found;
+    }
+
+    static bool replay(const string& base, uint64_t fromGeneration,
+                       const function<void(const string&, uint64_t, int64_t)>& apply, uint64_t& last) {
+        uint64_t newest;
+        if (newestSegment(base, newest)) {
+            for (uint64_t segment = fromGeneration; segment <= newest; segment++) {
+                if (!fileExists(segmentPath(base, segment))) return false;
+            }
+        }
+
+        uint64_t segment = fromGeneration;
+        while (true) {
+            string path = segmentPath(base, segment);
+            FileView file;
+            if (!file.open(path)) break;
+            string_view data = file.data();
+
+            size_t position = 0;
+            while (position + 8 <= data.size()) {
+                uint32_t length, crc;
+                memcpy(&length, data.data() + position, 4);
+                memcpy(&crc, data.data() + position + 4, 4);
+                if (length < 16 || length > data.size() - position - 8) break;
+
+                const char* payload = data.data() + position + 8;
+                if (crc32(payload, length) != crc) break;
+
+                int64_t timestamp;
+                uint64_t plays;
+                memcpy(&timestamp, payload, 8);
+                memcpy(&plays, payload + 8, 8);
+                apply(string(payload + 16, length - 16), plays, timestamp);
+                position += 8 + length;
+            }
+            bool torn = position < data.size();
+            file.close();
+            if (torn) truncateFile(path, position);
+            segment++;
+        }
+        last = segment == fromGeneration ? fromGeneration : segment - 1;
+        return true;
+    }
+
+    static void removeSegmentsBefore(const string& base, uint64_t keepFrom) {
+        for (uint64_t segment = keepFrom; segment > 0; segment--) {
+            if (remove(segmentPath(base, segment - 1).c_str()) != 0) break;
+        }
+    }
+
+    bool open(const string& base, uint64_t segment) {
+        close();
+        uint64_t bytes;
+        FileHandle opened = openAppend(segmentPath(base, segment), bytes);
+        if (opened == NO_FILE) return false;
+
+        basePath = base;
+        generation = segment;
+        fd = opened;
+        segmentBytes = bytes;
+        stopping = false;
+        failed = false;
+        syncDirectoryOf(segmentPath(base, segment));
+        writer = thread(&PlayEventLog::writerLoop, this);
+        return true;
+    }
+
+    void append(const string& songId, uint64_t plays, int64_t timestamp) {
+        string payload;
+        payload.reserve(16 + songId.size());
+        appendRaw(payload, &timestamp, 8);
+        appendRaw(payload, &plays, 8);
+        payload += songId;
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t crc = crc32(payload.data(), payload.size());
+
+        {
+            lock_guard<mutex> guard(bufferLock);
+            appendRaw(buffer, &length, 4);
+            appendRaw(buffer, &crc, 4);
+            buffer += payload;
+            appendedRecords++;
+            segmentBytes += 8 + payload.size();
+        }
+        wake.notify_one();
+    }
+
+    bool flush() {
+        unique_lock<mutex> lock(bufferLock);
+        uint64_t target = appendedRecords;
+        wake.notify_one();
+        durable.wait(lock, [&]() { return durableRecords >= target || fd == NO_FILE; });
+        return !failed;
+    }
+
+    uint64_t rotate() {
+        unique_lock<mutex> lock(bufferLock);
+        durable.wait(lock, [this]() { return retiredFd == NO_FILE; });
+
+        uint64_t bytes;
+        FileHandle next = openAppend(segmentPath(basePath, generation + 1), bytes);
+        if (next == NO_FILE) return generation;
+        retiredFd = fd;
+        retiredBuffer.swap(buffer);
+        retiredRecords = appendedRecords;
+        fd = next;
+        generation++;
+        segmentBytes = 0;
+        lock.unlock();
+        wake.notify_one();
+        return generation;
+    }
+
+    bool awaitRotation() {
+        unique_lock<mutex> lock(bufferLock);
+        durable.wait(lock, [this]() { return retiredFd == NO_FILE; });
+        return !failed;
+    }
+
+    uint64_t bytesSinceRotate() {
+        lock_guard<mutex> guard(bufferLock);
+        return segmentBytes;
+    }
+
+    bool healthy() {
+        lock_guard<mutex> guard(bufferLock);
+        return !failed;
+    }
+
+    void close() {
+        if (!writer.joinable()) return;
+        {
+            lock_guard<mutex> guard(bufferLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        lock_guard<mutex> guard(bufferLock);
+        closeFile(fd);
+        fd = NO_FILE;
+        durable.notify_all();
+    }
+};
+
+class FrequencyTracker {
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr size_t TOP_CAPACITY = 64;
+
+    struct Shard {
+        shared_mutex lock;
+        unordered_map<string, atomic<uint64_t>> counts;
+    };
+
+    struct PendingPlay {
+        string songId;
+        uint64_t count;
+        int64_t timestamp;
+    };
+
+    struct PlayBatch {
+        mutex lock;
+        vector<PendingPlay> plays;
+        size_t used = 0;
+    };
+
+    struct PlayQueue {
+        PlayBatch batches[SHARD_COUNT];
+        atomic<uint64_t> waiting{0};
+        vector<PendingPlay> spare;
+
+        void push(size_t shard, const string& songId, uint64_t count, int64_t timestamp) {
+            PlayBatch& batch = batches[shard];
+            {
+                lock_guard<mutex> guard(batch.lock);
+                if (batch.used == batch.plays.size()) batch.plays.emplace_back();
+                PendingPlay& play = batch.plays[batch.used++];
+                play.songId.assign(songId);
+                play.count = count;
+                play.timestamp = timestamp;
+            }
+            waiting.fetch_or(1ULL << shard, memory_order_release);
+        }
+
+        bool hasWaiting() const {
+            return waiting.load(memory_order_acquire) != 0;
+        }
+
+        template <typename Visit>
+        void drain(Visit visit) {
+            uint64_t mask = waiting.exchange(0, memory_order_acquire);
+            while (mask) {
+                PlayBatch& batch = batches[__builtin_ctzll(mask)];
+                mask &= mask - 1;
+                size_t used;
+                {
+                    lock_guard<mutex> guard(batch.lock);
+                    spare.swap(batch.plays);
+                    used = batch.used;
+                    batch.used = 0;
+                }
+                for (size_t i = 0; i < used; i++) visit(spare[i]);
+            }
+        }
+    };
+
+    typedef vector<pair<string, uint64_t>> TopList;
+
+    Shard shards[SHARD_COUNT];
+    PlayQueue pending;
+    atomic<uint64_t> topThreshold;
+    mutex topLock;
+    unordered_map<string, uint64_t> topCounts;
+    set<pair<uint64_t, string>> topOrder;
+    size_t topCapacity;
+    shared_ptr<const TopList> topSnapshot;
+
+    unique_ptr<CountMinSketch> sketch;
+    atomic<bool> approximate;
+
+    PlayQueue pendingWindowed;
+    vector<PendingPlay> windowedPlays;
+    mutex windowLock;
+    SlidingWindowCounter lastHour;
+    SlidingWindowCounter lastDay;
+    SlidingWindowCounter lastWeek;
+    ForwardDecayScores trending;
+    unordered_map<string, uint32_t> windowIds;
+    vector<string> windowNames;
+    vector<uint32_t> freeWindowIds;
+    size_t windowSweepAt;
+
+    static constexpr size_t WINDOW_SWEEP_MIN = 1024;
+
+    static constexpr uint64_t SNAPSHOT_MAGIC = 0x3250414e53595246ULL;
+    static constexpr uint64_t SNAPSHOT_MAGIC_V1 = 0x3150414e53595246ULL;
+    static constexpr uint64_t CHECKPOINT_BYTES = 64ull << 20;
+    unique_ptr<PlayEventLog> playLog;
+    mutable shared_mutex durabilityLock;
+    mutex checkpointRun;
+    mutex checkpointLock;
+    condition_variable checkpointWake;
+    bool stopCheckpoints;
+    thread checkpointer;
+    string durablePath;
+
+    mutex metadataLock;
+    unordered_map<string, Song> songMetadata;
+
+    static size_t shardIndex(const string& songId) {
+        return hash<string>()(songId) % SHARD_COUNT;
+    }
+
+    Shard& shardFor(const string& songId) {
+        return shards[shardIndex(songId)];
+    }
+
+    void offerTop(size_t shard, const string& songId, uint64_t count) {
+        if (count < topThreshold.load(memory_order_relaxed)) return;
+
+        pending.push(shard, songId, count, 0);
+        while (pending.hasWaiting() && topLock.try_lock()) {
+            drainPending();
+            topLock.unlock();
+        }
+    }
+
+    void admitTop(const string& songId, uint64_t count) {
+        auto existing = topCounts.find(songId);
+        if (existing != topCounts.end()) {
+            if (count > existing->second) {
+                auto entry = topOrder.extract({existing->second, songId});
+                existing->second = count;
+                entry.value().first = count;
+                topOrder.insert(move(entry));
+            }
+        } else if (topCounts.size() < topCapacity || count > topOrder.begin()->first) {
+            if (topCounts.size() == topCapacity) {
+                topCounts.erase(topOrder.begin()->second);
+                topOrder.erase(topOrder.begin());
+            }
+            topCounts[songId] = count;
+            topOrder.insert({count, songId});
+        }
+    }
+
+    void drainPending() {
+        if (!pending.hasWaiting()) return;
+
+        pending.drain([this](const PendingPlay& play) { admitTop(play.songId, play.count); });
+        publishTop();
+    }
+
+    void queueWindowed(const string& songId, uint64_t plays, int64_t timestamp) {
+        pendingWindowed.push(shardIndex(songId), songId, plays, timestamp);
+        while (pendingWindowed.hasWaiting() && windowLock.try_lock()) {
+            drainWindowed();
+            windowLock.unlock();
+        }
+    }
+
+    void drainWindowed() {
+        size_t count = 0;
+        pendingWindowed.drain([&](const PendingPlay& play) {
+            if (count == windowedPlays.size()) windowedPlays.emplace_back();
+            windowedPlays[count++] = play;
+        });
+        auto plays = windowedPlays.begin();
+        sort(plays, plays + count, [](const PendingPlay& a, const PendingPlay& b) {
+            return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.songId < b.songId;
+        });
+
+        for (size_t i = 0; i < count; i++) {
+            PendingPlay& play = plays[i];
+            if (i + 1 < count && plays[i + 1].timestamp == play.timestamp && plays[i + 1].songId == play.songId) {
+                plays[i + 1].count += play.count;
+                continue;
+            }
+
+            uint32_t id = internWindowed(play.songId);
+            lastHour.add(id, play.count, play.timestamp);
+            lastDay.add(id, play.count, play.timestamp);
+            lastWeek.add(id, play.count, play.timestamp);
+            trending.add(id, play.count, play.timestamp);
+        }
+    }
+
+    uint32_t internWindowed(const string& songId) {
+        auto found = windowIds.find(songId);
+        if (found != windowIds.end()) return found->second;
+        if (windowIds.size() >= windowSweepAt) sweepWindowIds();
+
+        uint32_t id;
+        if (!freeWindowIds.empty()) {
+            id = freeWindowIds.back();
+            freeWindowIds.pop_back();
+            windowNames[id] = songId;
+        } else {
+            id = static_cast<uint32_t>(windowNames.size());
+            windowNames.push_back(songId);
+        }
+        windowIds.emplace(songId, id);
+        return id;
+    }
+
+    void sweepWindowIds() {
+        for (auto it = windowIds.begin(); it != windowIds.end();) {
+            uint32_t id = it->second;
+            if (lastHour.contains(id) || lastDay.contains(id) || lastWeek.contains(id) || trending.contains(id)) {
+                ++it;
+                continue;
+            }
+            string().swap(windowNames[id]);
+            freeWindowIds.push_back(id);
+            it = windowIds.erase(it);
+        }
+        windowSweepAt = max(WINDOW_SWEEP_MIN, windowIds.size() * 2);
+    }
+
+    template <typename Value>
+    vector<pair<string, Value>> nameWindowed(const vector<pair<uint32_t, Value>>& ranked) const {
+        vector<pair<string, Value>> result;
+        result.reserve(ranked.size());
+        for (const auto& entry : ranked) result.push_back({windowNames[entry.first], entry.second});
+        return result;
+    }
+
+    SlidingWindowCounter* windowFor(const string& window) {
+        if (window == "hour") return &lastHour;
+        if (window == "day") return &lastDay;
+        if (window == "week") return &lastWeek;
+        return nullptr;
+    }
+
+    static void appendName(string& out, const string& name) {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        out.append(reinterpret_cast<const char*>(&length), 4);
+        out += name;
+    }
+
+    void appendWindowed(string& out) {
+        drainWindowed();
+        SlidingWindowCounter* windows[] = {&lastHour, &lastDay, &lastWeek};
+        for (SlidingWindowCounter* window : windows) {
+            size_t countAt = out.size();
+            uint64_t entries = 0;
+            out.append(8, '\0');
+            window->forEachCount([&](uint32_t id, uint64_t count, int64_t timestamp) {
+                appendName(out, windowNames[id]);
+                out.append(reinterpret_cast<const char*>(&timestamp), 8);
+                out.append(reinterpret_cast<const char*>(&count), 8);
+                entries++;
+            });
+            memcpy(&out[countAt], &entries, 8);
+        }
+
+        int64_t landmark = trending.landmarkTime();
+        out.append(reinterpret_cast<const char*>(&landmark), 8);
+        size_t countAt = out.size();
+        uint64_t entries = 0;
+        out.append(8, '\0');
+        trending.forEachScore([&](uint32_t id, double logWeight) {
+            appendName(out, windowNames[id]);
+            out.append(reinterpret_cast<const char*>(&logWeight), 8);
+            entries++;
+        });
+        memcpy(&out[countAt], &entries, 8);
+    }
+
+    bool restoreWindowed(string_view data, size_t position) {
+        size_t end = data.size() - 4;
+        auto readValue = [&](void* value) {
+            if (position + 8 > end) return false;
+            memcpy(value, data.data() + position, 8);
+            position += 8;
+            return true;
+        };
+        auto readName = [&](string& name) {
+            uint32_t length;
+            if (position + 4 > end) return false;
+            memcpy(&length, data.data() + position, 4);
+            if (position + 4 + length > end) return false;
+            name.assign(data.data() + position + 4, length);
+            position += 4 + length;
+            return true;
+        };
+
+        lock_guard<mutex> guard(windowLock);
+        drainWindowed();
+        string name;
+        SlidingWindowCounter* windows[] = {&lastHour, &lastDay, &lastWeek};
+        for (SlidingWindowCounter* window : windows) {
+            uint64_t entries;
+            if (!readValue(&entries)) return false;
+            for (uint64_t e = 0; e < entries; e++) {
+                int64_t timestamp;
+                uint64_t count;
+                if (!readName(name) || !readValue(&timestamp) || !readValue(&count)) return false;
+                window->add(internWindowed(name), count, timestamp);
+            }
+        }
+
+        int64_t landmark;
+        uint64_t entries;
+        if (!readValue(&landmark) || !readValue(&entries)) return false;
+        for (uint64_t e = 0; e < entries; e++) {
+            double logWeight;
+            if (!readName(name) || !readValue(&logWeight)) return false;
+            trending.restore(internWindowed(name), logWeight, landmark);
+        }
+        return true;
+    }
+
+    static int64_t currentTime() {
+        return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void countPlay(const string& songId, uint64_t plays) {
+        size_t index = shardIndex(songId);
+        if (approximate.load(memory_order_acquire)) {
+            offerTop(index, songId, sketch->add(songId, plays));
+            return;
+        }
+
+        Shard& shard = shards[index];
+        uint64_t count = 0;
+        bool found = false;
+        {
+            shared_lock<shared_mutex> guard(shard.lock);
+            if (approximate.load(memory_order_acquire)) {
+                guard.unlock();
+                offerTop(index, songId, sketch->add(songId, plays));
+                return;
+            }
+            auto it = shard.counts.find(songId);
+            if (it != shard.counts.end()) {
+                count = it->second.fetch_add(plays, memory_order_relaxed) + plays;
+                found = true;
+            }
+        }
+        if (!found) {
+            unique_lock<shared_mutex> guard(shard.lock);
+            if (approximate.load(memory_order_acquire)) {
+                guard.unlock();
+                offerTop(index, songId, sketch->add(songId, plays));
+                return;
+            }
+            count = shard.counts.try_emplace(songId, 0).first->second.fetch_add(plays, memory_order_relaxed) + plays;
+        }
+        offerTop(index, songId, count);
+    }
+
+    void publishTop() {
+        topThreshold.store(topCounts.size() < topCapacity ? 0 : topOrder.begin()->first, memory_order_relaxed);
+        auto snapshot = make_shared<TopList>();
+        snapshot->reserve(topOrder.size());
+        for (auto it = topOrder.rbegin(); it != topOrder.rend(); ++it) snapshot->push_back({it->second, it->first});
+        for (auto run = snapshot->begin(); run != snapshot->end();) {
+            auto next = find_if(run, snapshot->end(), [&](const pair<string, uint64_t>& entry) {
+                return entry.second != run->second;
+            });
+            reverse(run, next);
+            run = next;
+        }
+        atomic_store(&topSnapshot, shared_ptr<const TopList>(move(snapshot)));
+    }
+
+public:
+    explicit FrequencyTracker(double trendingHalfLifeSeconds = 6 * 3600)
+        : topThreshold(0), topCapacity(TOP_CAPACITY), topSnapshot(make_shared<TopList>()), approximate(false),
+          lastHour(60, 60), lastDay(900, 96), lastWeek(3600, 168),
+          trending(trendingHalfLifeSeconds), windowSweepAt(WINDOW_SWEEP_MIN), stopCheckpoints(false) {}
+
+    ~FrequencyTracker() {
+        stopDurability();
+        lock_guard<mutex> guard(topLock);
+        drainPending();
+        lock_guard<mutex> windowGuard(windowLock);
+        drainWindowed();
+    }
+
+    void initializeFrequencyMap() {
+        resetFrequencies();
+        lock_guard<mutex> guard(metadataLock);
+        songMetadata.clear();
+    }
+
+    void enableApproximateMode(double epsilon, double delta, size_t topSongs = TOP_CAPACITY) {
+        shared_lock<shared_mutex> durabilityGuard(durabilityLock);
+        if (approximate.load(memory_order_acquire) || playLog) return;
+
+        lock_guard<mutex> topGuard(topLock);
+        drainPending();
+        topCapacity = max(topSongs, TOP_CAPACITY);
+        sketch.reset(new CountMinSketch(CountMinSketch::withErrorBounds(epsilon, delta)));
+        for (Shard& shard : shards) {
+            unique_lock<shared_mutex> guard(shard.lock);
+            for (const auto& entry : shard.counts) {
+                uint64_t count = entry.second.load(memory_order_relaxed);
+                sketch->add(entry.first, count);
+                admitTop(entry.first, count);
+            }
+            shard.counts.clear();
+        }
+        publishTop();
+        approximate.store(true, memory_order_release);
+    }
+
+    size_t approximateTopLimit() const {
+        return isApproximate() ? topCapacity : numeric_limits<size_t>::max();
+    }
+
+    bool isApproximate() const {
+        return approximate.load(memory_order_acquire);
+    }
+
+    const CountMinSketch* approximateCounts() const {
+        return isApproximate() ? sketch.get() : nullptr;
+    }
+
+    bool mergeApproximate(FrequencyTracker& other) {
+        if (!isApproximate() || !other.isApproximate() || &other == this) return false;
+
+        TopList candidates;
+        {
+            lock_guard<mutex> guard(other.topLock);
+            other.drainPending();
+            if (!sketch->merge(*other.sketch)) return false;
+            candidates.assign(other.topCounts.begin(), other.topCounts.end());
+        }
+
+        lock_guard<mutex> guard(topLock);
+        drainPending();
+        candidates.insert(candidates.end(), topCounts.begin(), topCounts.end());
+        topCounts.clear();
+        topOrder.clear();
+        for (const auto& candidate : candidates) admitTop(candidate.first, sketch->estimate(candidate.first));
+        publishTop();
+        return true;
+    }
+
+    void incrementPlayCount(const string& songId, uint64_t plays = 1) {
+        incrementPlayCountAt(songId, currentTime(), plays);
+    }
+
+    void incrementPlayCountAt(const string& songId, int64_t timestamp, uint64_t plays = 1) {
+        if (plays == 0) return;
+        shared_lock<shared_mutex> guard(durabilityLock);
+        if (playLog) playLog->append(songId, plays, timestamp);
+        countPlay(songId, plays);
+        queueWindowed(songId, plays, timestamp);
+    }
+
+    bool enableDurability(const string& basePath, int checkpointSeconds = 300) {
+        if (isDurable() || isApproximate()) return false;
+
+        uint64_t segment = 0;
+        FileView file;
+        if (file.open(basePath + ".snapshot")) {
+            string_view data = file.data();
+
+            uint32_t crc = 0;
+            uint64_t magic = 0, entries = 0;
+            bool ok = data.size() >= 28;
+            if (ok) {
+                memcpy(&crc, data.data() + data.size() - 4, 4);
+                memcpy(&magic, data.data(), 8);
+                memcpy(&segment, data.data() + 8, 8);
+                memcpy(&entries, data.data() + 16, 8);
+                ok = (magic == SNAPSHOT_MAGIC || magic == SNAPSHOT_MAGIC_V1) &&
+                     PlayEventLog::crc32(data.data(), data.size() - 4) == crc;
+            }
+            if (!ok) return false;
+
+            size_t position = 24;
+            for (uint64_t e = 0; e < entries; e++) {
+                uint32_t length;
+                uint64_t count;
+                if (position + 16 > data.size()) return false;
+                memcpy(&length, data.data() + position, 4);
+                if (position + 16 + length > data.size()) return false;
+                string songId(data.data() + position + 4, length);
+                memcpy(&count, data.data() + position + 4 + length, 8);
+                position += 12 + length;
+                if (count > 0) countPlay(songId, count);
+            }
+            if (magic == SNAPSHOT_MAGIC && !restoreWindowed(data, position)) return false;
+            file.close();
+        }
+
+        uint64_t last;
+        bool replayed = PlayEventLog::replay(basePath, segment, [this](const string& songId, uint64_t plays, int64_t timestamp) {
+            countPlay(songId, plays);
+            queueWindowed(songId, plays, timestamp);
+        }, last);
+        if (!replayed) return false;
+
+        unique_ptr<PlayEventLog> log(new PlayEventLog());
+        if (!log->open(basePath, last)) return false;
+        {
+            unique_lock<shared_mutex> guard(durabilityLock);
+            if (playLog || isApproximate()) return false;
+            playLog = move(log);
+            durablePath = basePath;
+        }
+
+        stopCheckpoints = false;
+        checkpointer = thread([this, checkpointSeconds]() {
+            unique_lock<mutex> lock(checkpointLock);
+            auto lastCheckpoint = chrono::steady_clock::now();
+            while (!stopCheckpoints) {
+                checkpointWake.wait_for(lock, chrono::seconds(1));
+                if (stopCheckpoints) break;
+
+                bool due = chrono::steady_clock::now() - lastCheckpoint >= chrono::seconds(max(checkpointSeconds, 1));
+                uint64_t pendingBytes = 0;
+                {
+                    shared_lock<shared_mutex> guard(durabilityLock);
+                    if (playLog) pendingBytes = playLog->bytesSinceRotate();
+                }
+                if (pendingBytes >= CHECKPOINT_BYTES || (due && pendingBytes > 0)) {
+                    lock.unlock();
+                    checkpoint();
+                    lock.lock();
+                    lastCheckpoint = chrono::steady_clock::now();
+                }
+            }
+        });
+        return true;
+    }
+
+    bool checkpoint() {
+        lock_guard<mutex> running(checkpointRun);
+
+        vector<pair<string, uint64_t>> counts;
+        string windowed;
+        uint64_t segment;
+        string base;
+        {
+            unique_lock<shared_mutex> guard(durabilityLock);
+            if (!playLog) return false;
+            base = durablePath;
+            for (Shard& shard : shards) {
+                shared_lock<shared_mutex> shardGuard(shard.lock);
+                for (const auto& entry : shard.counts) {
+                    counts.push_back({entry.first, entry.second.load(memory_order_relaxed)});
+                }
+            }
+            {
+                lock_guard<mutex> windowGuard(windowLock);
+                appendWindowed(windowed);
+            }
+            uint64_t before = playLog->bytesSinceRotate();
+            segment = playLog->rotate();
+            if (before > 0 && playLog->bytesSinceRotate() != 0) return false;
+        }
+        if (!playLog->awaitRotation()) return false;
+
+        string snapshot;
+        snapshot.append(reinterpret_cast<const char*>(&SNAPSHOT_MAGIC), 8);
+        snapshot.append(reinterpret_cast<const char*>(&segment), 8);
+        uint64_t entries = counts.size();
+        snapshot.append(reinterpret_cast<const char*>(&entries), 8);
+        for (const auto& entry : counts) {
+            appendName(snapshot, entry.first);
+            snapshot.append(reinterpret_cast<const char*>(&entry.second), 8);
+        }
+        snapshot += windowed;
+        uint32_t crc = PlayEventLog::crc32(snapshot.data(), snapshot.size());
+        snapshot.append(reinterpret_cast<const char*>(&crc), 4);
+
+        if (!replaceFile(base + ".snapshot", snapshot)) return false;
+        PlayEventLog::removeSegmentsBefore(base, segment);
+        return true;
+    }
+
+    bool flushPlayLog() {
+        shared_lock<shared_mutex> guard(durabilityLock);
+        return playLog ? playLog->flush() : false;
+    }
+
+    bool isDurable() const {
+        shared_lock<shared_mutex> guard(durabilityLock);
+        return playLog != nullptr;
+    }
+
+    void stopDurability() {
+        if (!isDurable()) return;
+        {
+            lock_guard<mutex> guard(checkpointLock);
+            stopCheckpoints = true;
+        }
+        checkpointWake.notify_all();
+        if (checkpointer.joinable()) checkpointer.join();
+
+        lock_guard<mutex> running(checkpointRun);
+        unique_lock<shared_mutex> guard(durabilityLock);
+        if (!playLog) return;
+        playLog->flush();
+        playLog.reset();
+    }
+
+    uint64_t getPlayCount(const string& songId) {
+        if (isApproximate()) return sketch->estimate(songId);
+
+        Shard& shard = shardFor(songId);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.counts.find(songId);
+        return it == shard.counts.end() ? 0 : it->second.load(memory_order_relaxed);
+    }
+
+    vector<pair<string, uint64_t>> getMostPlayed(int k) {
+        if (k <= 0) return {};
+        size_t wanted = static_cast<size_t>(k);
+
+        if (wanted <= TOP_CAPACITY || isApproximate()) {
+            shared_ptr<const TopList> snapshot = atomic_load(&topSnapshot);
+            size_t count = min(wanted, snapshot->size());
+            return TopList(snapshot->begin(), snapshot->begin() + count);
+        }
+        TopList songs;
+        for (Shard& shard : shards) {
+            shared_lock<shared_mutex> guard(shard.lock);
+            for (const auto& entry : shard.counts) songs.push_back({entry.first, entry.second.load(memory_order_relaxed)});
+        }
+        size_t count = min(wanted, songs.size());
+        partial_sort(songs.begin(), songs.begin() + count, songs.end(),
+                     [](const pair<string, uint64_t>& a, const pair<string, uint64_t>& b) {
+                         return a.second != b.second ? a.second > b.second : a.first < b.first;
+                     });
+        songs.resize(count);
+        return songs;
+    }
+
+    void resetFrequencies() {
+        {
+            lock_guard<mutex> guard(topLock);
+            topThreshold.store(0, memory_order_relaxed);
+            for (Shard& shard : shards) {
+                unique_lock<shared_mutex> shardGuard(shard.lock);
+                shard.counts.clear();
+            }
+            if (sketch) sketch->clear();
+            drainPending();
+            topCounts.clear();
+            topOrder.clear();
+            publishTop();
+
+            lock_guard<mutex> windowGuard(windowLock);
+            drainWindowed();
+            lastHour.clear();
+            lastDay.clear();
+            lastWeek.clear();
+            trending.clear();
+            windowIds.clear();
+            windowNames.clear();
+            freeWindowIds.clear();
+            windowSweepAt = WINDOW_SWEEP_MIN;
+        }
+        if (isDurable()) checkpoint();
+    }
+
+    vector<pair<string, uint64_t>> getMostPlayedInWindow(const string& window, int k, int64_t now = -1) {
+        lock_guard<mutex> guard(windowLock);
+        drainWindowed();
+        SlidingWindowCounter* counter = windowFor(window);
+        return counter ? nameWindowed(counter->top(k, now < 0 ? currentTime() : now)) : vector<pair<string, uint64_t>>();
+    }
+
+    uint64_t getWindowedPlayCount(const string& songId, const string& window, int64_t now = -1) {
+        lock_guard<mutex> guard(windowLock);
+        drainWindowed();
+        SlidingWindowCounter* counter = windowFor(window);
+        auto id = windowIds.find(songId);
+        if (!counter || id == windowIds.end()) return 0;
+        return counter->count(id->second, now < 0 ? currentTime() : now);
+    }
+
+    vector<pair<string, double>> getTrending(int k, int64_t now = -1) {
+        lock_guard<mutex> guard(windowLock);
+        drainWindowed();
+        return nameWindowed(trending.top(k, now < 0 ? currentTime() : now));
+    }
+
+    Song getSongMetadata(const string& songId) {
+        lock_guard<mutex> guard(metadataLock);
+        return songMetadata[songId];
+    }
+
+    void updateSongInfo(const string& songId, const Song& newData) {
+        lock_guard<mutex> guard(metadataLock);
+        songMetadata[songId] = newData;
+    }
+
+    void addSongMetadata(const string& songId, const Song& song) {
+        {
+            lock_guard<mutex> guard(metadataLock);
+            songMetadata[songId] = song;
+        }
+        Shard& shard = shardFor(songId);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if (!approximate.load(memory_order_acquire)) shard.counts.try_emplace(songId, 0);
+    }
+};
+
+
+class PlaylistHeap {
+private:
+    struct HeapEntry {
+        double priority;
+        uint32_t slot;
+    };
+
+    static constexpr size_t ARITY = 4;
+    static constexpr size_t PARALLEL_BUILD = 1 << 18;
+    static constexpr int32_t EMPTY_BUCKET = -1;
+    static constexpr int32_t DELETED_BUCKET = -2;
+    static constexpr double DEFAULT_SONG_SECONDS = 180;
+    static constexpr size_t FIT_CANDIDATES = 1024;
+    static constexpr size_t FIT_BITS = 1 << 15;
+    static constexpr float TEMPO_STEP = 10;
+    static constexpr float KEY_WEIGHT = 2;
+    static constexpr float ENERGY_WEIGHT = 5;
+    static constexpr size_t TRANSITION_MATRIX_LIMIT = 2048;
+    static constexpr int ORDER_BUDGET_MILLISECONDS = 5;
+
+    struct TransitionFeatures {
+        vector<float> tempo;
+        vector<float> keyX;
+        vector<float> keyY;
+        vector<float> energy;
+        vector<int32_t> artist;
+    };
+
+    vector<HeapEntry> heap;
+    vector<Song> heapSongs;
+    vector<int32_t> heapPosition;
+    vector<uint32_t> freeSlots;
+    vector<int32_t> nameTable;
+    vector<int32_t> sameName;
+    size_t usedBuckets = 0;
+    unordered_map<string, int32_t> tagIds;
+    vector<vector<uint32_t>> genreSlots;
+    vector<vector<uint32_t>> moodSlots;
+    vector<int32_t> slotGenre;
+    vector<int32_t> slotMood;
+    vector<uint32_t> genreSlotPosition;
+    vector<uint32_t> moodSlotPosition;
+    vector<Song> currentPlaylist;
+
+    static bool before(const HeapEntry& a, const HeapEntry& b) {
+        if (a.priority != b.priority) return a.priority > b.priority;
+        return a.slot < b.slot;
+    }
+
+    static double Song::*attributeFor(const string& criteria) {
+        if (criteria == "rating") return &Song::rating;
+        if (criteria == "frequency") return &Song::frequency;
+        if (criteria == "tempo") return &Song::tempo;
+        if (criteria == "duration") return &Song::duration;
+        return nullptr;
+    }
+
+    void place(size_t position, const HeapEntry& entry) {
+        heap[position] = entry;
+        heapPosition[entry.slot] = static_cast<int32_t>(position);
+    }
+
+    void siftUp(size_t position) {
+        HeapEntry entry = heap[position];
+        while (position > 0) {
+            size_t parent = (position - 1) / ARITY;
+            if (!before(entry, heap[parent])) break;
+            place(position, heap[parent]);
+            position = parent;
+        }
+        place(position, entry);
+    }
+
+    void siftDown(size_t position) {
+        HeapEntry entry = heap[position];
+        while (true) {
+            size_t first = position * ARITY + 1;
+            if (first >= heap.size()) break;
+
+            size_t best = first;
+            size_t last = min(first + ARITY, heap.size());
+            for (size_t child = first + 1; child < last; child++) {
+                if (before(heap[child], heap[best])) best = child;
+            }
+            if (!before(heap[best], entry)) break;
+            place(position, heap[best]);
+            position = best;
+        }
+        place(position, entry);
+    }
+
+    void restoreHeap(size_t workers = 1) {
+        if (heap.size() < 2) return;
+
+        vector<size_t> levels(1, 0);
+        size_t lastParent = (heap.size() - 2) / ARITY;
+        while (levels.back() <= lastParent) levels.push_back(levels.back() * ARITY + 1);
+
+        for (size_t level = levels.size() - 1; level > 0; level--) {
+            size_t begin = levels[level - 1];
+            size_t end = min(levels[level], lastParent + 1);
+            size_t levelWorkers = end - begin >= PARALLEL_BUILD / ARITY ? workers : 1;
+            parallelFor(end - begin, levelWorkers, [&](size_t from, size_t to) {
+                for (size_t position = end - from; position > end - to; position--) siftDown(position - 1);
+            });
+        }
+    }
+
+    template <typename Task>
+    static void parallelFor(size_t count, size_t workers, Task task) {
+        if (workers <= 1) {
+            task(0, count);
+            return;
+        }
+
+        vector<thread> threads;
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() { task(count * w / workers, count * (w + 1) / workers); });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+    void reposition(size_t position) {
+        if (position > 0 && before(heap[position], heap[(position - 1) / ARITY])) siftUp(position);
+        else siftDown(position);
+    }
+
+    void removeAt(size_t position) {
+        uint32_t slot = heap[position].slot;
+        HeapEntry last = heap.back();
+        heap.pop_back();
+        heapPosition[slot] = -1;
+        heapSongs[slot] = Song();
+        freeSlots.push_back(slot);
+        if (position < heap.size()) {
+            place(position, last);
+            reposition(position);
+        }
+    }
+
+    size_t findBucket(const string& songName, bool& found) const {
+        size_t mask = nameTable.size() - 1;
+        size_t bucket = hash<string>()(songName) & mask;
+        size_t reusable = nameTable.size();
+        while (true) {
+            int32_t slot = nameTable[bucket];
+            if (slot == EMPTY_BUCKET) {
+                found = false;
+                return reusable < nameTable.size() ? reusable : bucket;
+            }
+            if (slot == DELETED_BUCKET) {
+                if (reusable == nameTable.size()) reusable = bucket;
+            } else if (heapSongs[slot].name == songName) {
+                found = true;
+                return bucket;
+            }
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    void reserveNames(size_t names) {
+        if ((usedBuckets + 1) * 2 <= nameTable.size() && names * 2 <= nameTable.size()) return;
+
+        size_t capacity = 16;
+        while (capacity < max(names, usedBuckets + 1) * 2) capacity *= 2;
+        vector<int32_t> heads;
+        for (int32_t slot : nameTable) {
+            if (slot >= 0) heads.push_back(slot);
+        }
+        nameTable.assign(capacity, EMPTY_BUCKET);
+        usedBuckets = heads.size();
+        for (int32_t slot : heads) {
+            bool found;
+            nameTable[findBucket(heapSongs[slot].name, found)] = slot;
+        }
+    }
+
+    int32_t linkName(uint32_t slot) {
+        reserveNames(0);
+        bool found;
+        size_t bucket = findBucket(heapSongs[slot].name, found);
+        if (!found) {
+            if (nameTable[bucket] == EMPTY_BUCKET) usedBuckets++;
+            nameTable[bucket] = static_cast<int32_t>(slot);
+            sameName[slot] = -1;
+            return -1;
+        }
+
+        for (int32_t other = nameTable[bucket]; other >= 0; other = sameName[other]) {
+            if (heapSongs[other].artist == heapSongs[slot].artist) return other;
+        }
+        sameName[slot] = nameTable[bucket];
+        nameTable[bucket] = static_cast<int32_t>(slot);
+        return -1;
+    }
+
+    void unlinkName(uint32_t slot) {
+        bool found;
+        size_t bucket = findBucket(heapSongs[slot].name, found);
+        if (nameTable[bucket] == static_cast<int32_t>(slot)) {
+            nameTable[bucket] = sameName[slot] >= 0 ? sameName[slot] : DELETED_BUCKET;
+            return;
+        }
+        for (int32_t other = nameTable[bucket]; other >= 0; other = sameName[other]) {
+            if (sameName[other] == static_cast<int32_t>(slot)) {
+                sameName[other] = sameName[slot];
+                return;
+            }
+        }
+    }
+
+    static string tagKey(const string& text) {
+        string key = MusicTrie::normalizeKey(text);
+        return key == "any" ? "" : key;
+    }
+
+    static string songTag(const Song& song, const char* field) {
+        auto it = song.metadata.find(field);
+        return it == song.metadata.end() ? "" : tagKey(it->second);
+    }
+
+    int32_t tagId(const string& key) {
+        if (key.empty()) return -1;
+        auto inserted = tagIds.emplace(key, static_cast<int32_t>(tagIds.size()));
+        if (inserted.second) {
+            genreSlots.emplace_back();
+            moodSlots.emplace_back();
+        }
+        return inserted.first->second;
+    }
+
+    static void linkTag(vector<uint32_t>& slots, vector<uint32_t>& positions, uint32_t slot) {
+        positions[slot] = static_cast<uint32_t>(slots.size());
+        slots.push_back(slot);
+    }
+
+    static void unlinkTag(vector<uint32_t>& slots, vector<uint32_t>& positions, uint32_t slot) {
+        uint32_t moved = slots.back();
+        slots[positions[slot]] = moved;
+        positions[moved] = positions[slot];
+        slots.pop_back();
+    }
+
+    void indexTags(uint32_t slot, int32_t genre, int32_t mood) {
+        if (slotGenre.size() < heapSongs.size()) {
+            slotGenre.resize(heapSongs.size(), -1);
+            slotMood.resize(heapSongs.size(), -1);
+            genreSlotPosition.resize(heapSongs.size(), 0);
+            moodSlotPosition.resize(heapSongs.size(), 0);
+        }
+        slotGenre[slot] = genre;
+        if (genre >= 0) linkTag(genreSlots[genre], genreSlotPosition, slot);
+        slotMood[slot] = mood;
+        if (mood >= 0) linkTag(moodSlots[mood], moodSlotPosition, slot);
+    }
+
+    void indexTags(uint32_t slot) {
+        indexTags(slot, tagId(songTag(heapSongs[slot], "genre")), tagId(songTag(heapSongs[slot], "mood")));
+    }
+
+    void unindexTags(uint32_t slot) {
+        if (slotGenre[slot] >= 0) unlinkTag(genreSlots[slotGenre[slot]], genreSlotPosition, slot);
+        if (slotMood[slot] >= 0) unlinkTag(moodSlots[slotMood[slot]], moodSlotPosition, slot);
+        slotGenre[slot] = slotMood[slot] = -1;
+    }
+
+    bool findTagLists(const string& mood, const string& genre, const vector<uint32_t>*& genreList,
+                      const vector<uint32_t>*& moodList, int32_t& genreId, int32_t& moodId) const {
+        string genreKey = tagKey(genre);
+        string moodKey = tagKey(mood);
+        genreList = moodList = nullptr;
+        genreId = moodId = -1;
+        if (!genreKey.empty()) {
+            auto found = tagIds.find(genreKey);
+            if (found == tagIds.end() || genreSlots[found->second].empty()) return false;
+            genreId = found->second;
+            genreList = &genreSlots[genreId];
+        }
+        if (!moodKey.empty()) {
+            auto found = tagIds.find(moodKey);
+            if (found == tagIds.end() || moodSlots[found->second].empty()) return false;
+            moodId = found->second;
+            moodList = &moodSlots[moodId];
+        }
+        return true;
+    }
+
+    template <typename Visit>
+    void forEachTagged(const vector<uint32_t>* genreList, const vector<uint32_t>* moodList,
+                       int32_t genreId, int32_t moodId, Visit visit) const {
+        if (genreList && moodList) {
+            bool genreSmaller = genreList->size() <= moodList->size();
+            const vector<uint32_t>& scan = genreSmaller ? *genreList : *moodList;
+            const vector<int32_t>& otherTags = genreSmaller ? slotMood : slotGenre;
+            int32_t otherId = genreSmaller ? moodId : genreId;
+            for (uint32_t slot : scan) {
+                if (otherTags[slot] == otherId) visit(slot);
+            }
+        } else {
+            for (uint32_t slot : genreList ? *genreList : *moodList) visit(slot);
+        }
+    }
+
+    vector<uint32_t> fitCandidates(const string& mood, const string& genre, size_t limit) {
+        const vector<uint32_t>* genreList;
+        const vector<uint32_t>* moodList;
+        int32_t genreId, moodId;
+        if (!findTagLists(mood, genre, genreList, moodList, genreId, moodId)) return {};
+
+        vector<uint32_t> candidates;
+        auto better = [this](uint32_t a, uint32_t b) {
+            return before(heap[heapPosition[a]], heap[heapPosition[b]]);
+        };
+        if (!genreList && !moodList) {
+            auto worse = [this](size_t a, size_t b) { return before(heap[b], heap[a]); };
+            vector<size_t> frontier;
+            if (!heap.empty()) frontier.push_back(0);
+            while (!frontier.empty() && candidates.size() < limit) {
+                pop_heap(frontier.begin(), frontier.end(), worse);
+                size_t position = frontier.back();
+                frontier.pop_back();
+                candidates.push_back(heap[position].slot);
+
+                size_t first = position * ARITY + 1;
+                for (size_t child = first; child < min(first + ARITY, heap.size()); child++) {
+                    frontier.push_back(child);
+                    push_heap(frontier.begin(), frontier.end(), worse);
+                }
+            }
+            return candidates;
+        }
+
+        forEachTagged(genreList, moodList, genreId, moodId, [&candidates](uint32_t slot) { candidates.push_back(slot); });
+
+        if (candidates.size() > limit) {
+            nth_element(candidates.begin(), candidates.begin() + limit, candidates.end(), better);
+            candidates.resize(limit);
+        }
+        sort(candidates.begin(), candidates.end(), better);
+        return candidates;
+    }
+
+    vector<uint32_t> fitDuration(const vector<uint32_t>& candidates, double targetSeconds) {
+        auto seconds = [this](uint32_t slot) {
+            return heapSongs[slot].duration > 0 ? heapSongs[slot].duration : DEFAULT_SONG_SECONDS;
+        };
+
+        vector<uint32_t> chosen;
+        double remaining = targetSeconds;
+        size_t next = 0;
+        double reserve = DEFAULT_SONG_SECONDS * 64;
+        while (next < candidates.size() && remaining - seconds(candidates[next]) >= reserve) {
+            remaining -= seconds(candidates[next]);
+            chosen.push_back(candidates[next++]);
+        }
+
+        size_t count = min(candidates.size() - next, FIT_CANDIDATES);
+        double longest = 0;
+        for (size_t i = 0; i < count; i++) longest = max(longest, seconds(candidates[next + i]));
+        if (count == 0 || remaining <= 0) return chosen;
+
+        double unit = max(1.0, ceil((remaining + longest + 1) / FIT_BITS));
+        size_t span = static_cast<size_t>((remaining + longest) / unit) + 1;
+        size_t words = (span + 63) / 64;
+        vector<size_t> weight(count);
+        for (size_t i = 0; i < count; i++) {
+            weight[i] = max<size_t>(1, static_cast<size_t>(llround(seconds(candidates[next + i]) / unit)));
+        }
+
+        vector<uint64_t> reach((count + 1) * words, 0);
+        reach[0] = 1;
+        for (size_t i = 0; i < count; i++) {
+            const uint64_t* from = &reach[i * words];
+            uint64_t* to = &reach[(i + 1) * words];
+            size_t wordShift = weight[i] / 64;
+            size_t bitShift = weight[i] % 64;
+            for (size_t w = 0; w < words; w++) {
+                uint64_t shifted = 0;
+                if (w >= wordShift) {
+                    shifted = from[w - wordShift] << bitShift;
+                    if (bitShift && w > wordShift) shifted |= from[w - wordShift - 1] >> (64 - bitShift);
+                }
+                to[w] = from[w] | shifted;
+            }
+        }
+
+        auto reachable = [&](size_t row, size_t sum) {
+            return sum < span && (reach[row * words + sum / 64] >> (sum % 64)) & 1;
+        };
+        double goal = remaining / unit;
+        size_t best = 0;
+        double bestGap = goal;
+        for (size_t sum = 1; sum < span; sum++) {
+            double gap = fabs(static_cast<double>(sum) - goal);
+            if (reachable(count, sum) && (gap < bestGap || (gap == bestGap && sum <= goal))) {
+                best = sum;
+                bestGap = gap;
+            }
+        }
+
+        vector<uint32_t> fitted;
+        for (size_t i = count; i > 0 && best > 0; i--) {
+            if (reachable(i - 1, best)) continue;
+            fitted.push_back(candidates[next + i - 1]);
+            best -= weight[i - 1];
+        }
+        chosen.insert(chosen.end(), fitted.rbegin(), fitted.rend());
+        return chosen;
+    }
+
+    static TransitionFeatures transitionFeatures(const vector<Song>& songs) {
+        size_t n = songs.size();
+        double tempoTotal = 0, energyTotal = 0;
+        size_t tempoKnown = 0, energyKnown = 0;
+        for (const Song& song : songs) {
+            if (song.tempo > 0) {
+                tempoTotal += song.tempo;
+                tempoKnown++;
+            }
+            if (song.metadata.count("energy")) {
+                energyTotal += song.energy;
+                energyKnown++;
+            }
+        }
+        double tempoMean = tempoKnown ? tempoTotal / tempoKnown : 0;
+        double energyMean = energyKnown ? energyTotal / energyKnown : 0;
+
+        TransitionFeatures features;
+        features.tempo.resize(n);
+        features.keyX.resize(n);
+        features.keyY.resize(n);
+        features.energy.resize(n);
+        features.artist.resize(n);
+        unordered_map<string, int32_t> artists;
+        for (size_t i = 0; i < n; i++) {
+            const Song& song = songs[i];
+            features.tempo[i] = static_cast<float>((song.tempo > 0 ? song.tempo : tempoMean) / TEMPO_STEP);
+            if (song.key >= 0) {
+                constexpr double pi = 3.14159265358979323846;
+                double angle = 2 * pi * (song.key / 2) / 12;
+                double radius = KEY_WEIGHT * (song.key % 2 ? 1.0 : 0.7);
+                features.keyX[i] = static_cast<float>(radius * cos(angle));
+                features.keyY[i] = static_cast<float>(radius * sin(angle));
+            }
+            features.energy[i] = static_cast<float>((song.metadata.count("energy") ? song.energy : energyMean) * ENERGY_WEIGHT);
+
+            features.artist[i] = artists.emplace(MusicTrie::normalizeKey(song.artist),
+                                                 static_cast<int32_t>(artists.size())).first->second;
+        }
+        return features;
+    }
+
+    static float transitionCost(const TransitionFeatures& f, size_t a, size_t b) {
+        float dt = f.tempo[b] - f.tempo[a];
+        float dx = f.keyX[b] - f.keyX[a];
+        float dy = f.keyY[b] - f.keyY[a];
+        float de = f.energy[b] - f.energy[a];
+        return sqrt(dt * dt + dx * dx + dy * dy + de * de);
+    }
+
+    static void transitionRow(const TransitionFeatures& f, size_t from, float* out) {
+        size_t n = f.tempo.size();
+        size_t j = 0;
+
+#if defined(__AVX2__)
+        __m256 vTempo = _mm256_set1_ps(f.tempo[from]);
+        __m256 vKeyX = _mm256_set1_ps(f.keyX[from]);
+        __m256 vKeyY = _mm256_set1_ps(f.keyY[from]);
+        __m256 vEnergy = _mm256_set1_ps(f.energy[from]);
+
+        for (; j + 8 <= n; j += 8) {
+            __m256 dt = _mm256_sub_ps(_mm256_loadu_ps(&f.tempo[j]), vTempo);
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&f.keyX[j]), vKeyX);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&f.keyY[j]), vKeyY);
+            __m256 de = _mm256_sub_ps(_mm256_loadu_ps(&f.energy[j]), vEnergy);
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dt, dt), _mm256_mul_ps(dx, dx)),
+                                                     _mm256_mul_ps(dy, dy)),
+                                       _mm256_mul_ps(de, de));
+            _mm256_storeu_ps(out + j, _mm256_sqrt_ps(sum));
+        }
+#elif defined(__SSE2__)
+        __m128 vTempo = _mm_set1_ps(f.tempo[from]);
+        __m128 vKeyX = _mm_set1_ps(f.keyX[from]);
+        __m128 vKeyY = _mm_set1_ps(f.keyY[from]);
+        __m128 vEnergy = _mm_set1_ps(f.energy[from]);
+
+        for (; j + 4 <= n; j += 4) {
+            __m128 dt = _mm_sub_ps(_mm_loadu_ps(&f.tempo[j]), vTempo);
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(&f.keyX[j]), vKeyX);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(&f.keyY[j]), vKeyY);
+            __m128 de = _mm_sub_ps(_mm_loadu_ps(&f.energy[j]), vEnergy);
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dt, dt), _mm_mul_ps(dx, dx)), _mm_mul_ps(dy, dy)),
+                                    _mm_mul_ps(de, de));
+            _mm_storeu_ps(out + j, _mm_sqrt_ps(sum));
+        }
+#endif
+
+        for (; j < n; j++) out[j] = transitionCost(f, from, j);
+    }
+
+    int32_t findSong(const string& songName, const string& artist) const {
+        if (nameTable.empty()) return -1;
+
+        bool found;
+        size_t bucket = findBucket(songName, found);
+        if (!found) return -1;
+
+        for (int32_t slot = nameTable[bucket]; slot >= 0; slot = sameName[slot]) {
+            if (heapSongs[slot].artist == artist) return slot;
+        }
+        return -1;
+    }
+
+public:
+    void buildMaxHeap(const vector<Song>& songs, const string& criteria = "rating") {
+        buildMaxHeap(vector<Song>(songs), criteria);
+    }
+
+    void buildMaxHeap(vector<Song>&& songs, const string& criteria = "rating") {
+        heapSongs = move(songs);
+        freeSlots.clear();
+        nameTable.clear();
+        usedBuckets = 0;
+        tagIds.clear();
+        genreSlots.clear();
+        moodSlots.clear();
+        slotGenre.clear();
+        slotMood.clear();
+
+        size_t count = heapSongs.size();
+        size_t workers = count >= PARALLEL_BUILD ? max(1u, thread::hardware_concurrency()) : 1;
+        double Song::*field = attributeFor(criteria);
+        heap.resize(count);
+        heapPosition.resize(count);
+        sameName.resize(count);
+        vector<string> genreKeys(count);
+        vector<string> moodKeys(count);
+
+        vector<pair<uint32_t, uint32_t>> duplicates;
+        auto indexNames = [&]() {
+            reserveNames(count);
+            for (uint32_t slot = 0; slot < count; slot++) {
+                int32_t existing = linkName(slot);
+                if (existing >= 0) duplicates.push_back({static_cast<uint32_t>(existing), slot});
+            }
+        };
+        thread namer;
+        if (workers > 1) namer = thread(indexNames);
+        parallelFor(count, workers, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                heap[i] = {field ? heapSongs[i].*field : 1.0, static_cast<uint32_t>(i)};
+                heapPosition[i] = static_cast<int32_t>(i);
+                genreKeys[i] = songTag(heapSongs[i], "genre");
+                moodKeys[i] = songTag(heapSongs[i], "mood");
+            }
+        });
+        if (workers > 1) namer.join();
+        else indexNames();
+
+        if (!duplicates.empty()) {
+            for (const auto& duplicate : duplicates) {
+                heapSongs[duplicate.first] = move(heapSongs[duplicate.second]);
+                heap[duplicate.first].priority = heap[duplicate.second].priority;
+                genreKeys[duplicate.first] = move(genreKeys[duplicate.second]);
+                moodKeys[duplicate.first] = move(moodKeys[duplicate.second]);
+                heapSongs[duplicate.second] = Song();
+                heapPosition[duplicate.second] = -1;
+            }
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (heapPosition[i] < 0) freeSlots.push_back(static_cast<uint32_t>(i));
+                else place(kept++, heap[i]);
+            }
+            heap.resize(kept);
+        }
+
+        for (const HeapEntry& entry : heap) indexTags(entry.slot, tagId(genreKeys[entry.slot]), tagId(moodKeys[entry.slot]));
+        restoreHeap(workers);
+    }
+
+    vector<Song> extractTopK(int k) {
+        vector<Song> topSongs;
+        if (k <= 0 || heap.empty()) return topSongs;
+
+        topSongs.reserve(min(static_cast<size_t>(k), heap.size()));
+        auto worse = [this](size_t a, size_t b) { return before(heap[b], heap[a]); };
+        vector<size_t> frontier(1, 0);
+        while (!frontier.empty() && topSongs.size() < static_cast<size_t>(k)) {
+            pop_heap(frontier.begin(), frontier.end(), worse);
+            size_t position = frontier.back();
+            frontier.pop_back();
+            topSongs.push_back(heapSongs[heap[position].slot]);
+
+            size_t first = position * ARITY + 1;
+            for (size_t child = first; child < min(first + ARITY, heap.size()); child++) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), worse);
+            }
+        }
+
+        return topSongs;
+    }
+
+    void insertSong(const Song& song, double priority) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            heapSongs[slot] = song;
+        } else {
+            slot = static_cast<uint32_t>(heapSongs.size());
+            heapSongs.push_back(song);
+            heapPosition.push_back(-1);
+            sameName.push_back(-1);
+        }
+
+        int32_t existing = linkName(slot);
+        if (existing >= 0) {
+            unindexTags(existing);
+            heapSongs[existing] = move(heapSongs[slot]);
+            heapSongs[slot] = Song();
+            freeSlots.push_back(slot);
+            indexTags(existing);
+            size_t position = static_cast<size_t>(heapPosition[existing]);
+            heap[position].priority = priority;
+            reposition(position);
+            return;
+        }
+        indexTags(slot);
+        heap.push_back({priority, slot});
+        siftUp(heap.size() - 1);
+    }
+
+    bool updatePriority(const string& songName, const string& artist, double priority) {
+        int32_t slot = findSong(songName, artist);
+        if (slot < 0) return false;
+
+        size_t position = static_cast<size_t>(heapPosition[slot]);
+        heap[position].priority = priority;
+        reposition(position);
+        return true;
+    }
+
+    bool removeSong(const string& songName, const string& artist) {
+        int32_t slot = findSong(songName, artist);
+        if (slot < 0) return false;
+
+        unlinkName(slot);
+        unindexTags(slot);
+        removeAt(static_cast<size_t>(heapPosition[slot]));
+        return true;
+    }
+
+    double getPriority(const string& songName, const string& artist) const {
+        int32_t slot = findSong(songName, artist);
+        return slot < 0 ? -numeric_limits<double>::infinity() : heap[heapPosition[slot]].priority;
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+    size_t countMatching(const string& mood, const string& genre) const {
+        const vector<uint32_t>* genreList;
+        const vector<uint32_t>* moodList;
+        int32_t genreId, moodId;
+        if (!findTagLists(mood, genre, genreList, moodList, genreId, moodId)) return 0;
+        if (!genreList && !moodList) return heap.size();
+
+        size_t count = 0;
+        forEachTagged(genreList, moodList, genreId, moodId, [&count](uint32_t) { count++; });
+        return count;
+    }
+
+    void heapify() {
+        restoreHeap();
+    }
+
+    vector<Song> getTopSongs(int k, const string& criteria) {
+        return extractTopK(k);
+    }
+
+    size_t mergePlaylists(const vector<const vector<Song>*>& playlists, const function<bool(const Song&)>& sink,
+                          const string& criteria = "rating", bool roundRobin = false) const {
+        double Song::*field = attributeFor(criteria);
+        vector<size_t> next(playlists.size(), 0);
+        size_t emitted = 0;
+
+        vector<size_t> active;
+        size_t total = 0;
+        for (size_t p = 0; p < playlists.size(); p++) {
+            if (playlists[p] && !playlists[p]->empty()) {
+                active.push_back(p);
+                total += playlists[p]->size();
+            }
+        }
+        size_t capacity = 64;
+        while (capacity < min<size_t>(total, 4096) * 2) capacity *= 2;
+        vector<pair<size_t, const Song*>> seen(capacity, {0, nullptr});
+        size_t used = 0;
+
+        auto claim = [&](const Song& song) {
+            if ((used + 1) * 2 > seen.size()) {
+                vector<pair<size_t, const Song*>> grown(seen.size() * 2, {0, nullptr});
+                for (const auto& entry : seen) {
+                    if (!entry.second) continue;
+                    size_t bucket = entry.first & (grown.size() - 1);
+                    while (grown[bucket].second) bucket = (bucket + 1) & (grown.size() - 1);
+                    grown[bucket] = entry;
+                }
+                seen.swap(grown);
+            }
+
+            size_t mask = seen.size() - 1;
+            size_t hashValue = hash<string>()(song.name) * 1000003u ^ hash<string>()(song.artist);
+            size_t bucket = hashValue & mask;
+            while (seen[bucket].second) {
+                const Song& other = *seen[bucket].second;
+                if (seen[bucket].first == hashValue && other.name == song.name && other.artist == song.artist) {
+                    return false;
+                }
+                bucket = (bucket + 1) & mask;
+            }
+            seen[bucket] = {hashValue, &song};
+            used++;
+            return true;
+        };
+        auto claimHead = [&](size_t p) {
+            const vector<Song>& list = *playlists[p];
+            while (next[p] < list.size() && !claim(list[next[p]])) next[p]++;
+            return next[p] < list.size();
+        };
+        auto emit = [&](size_t p) {
+            emitted++;
+            return sink((*playlists[p])[next[p]++]);
+        };
+
+        if (roundRobin) {
+            while (!active.empty()) {
+                size_t kept = 0;
+                for (size_t p : active) {
+                    if (!claimHead(p)) continue;
+                    if (!emit(p)) return emitted;
+                    active[kept++] = p;
+                }
+                active.resize(kept);
+            }
+            return emitted;
+        }
+
+        auto headPriority = [&](size_t p) {
+            const Song& song = (*playlists[p])[next[p]];
+            return field ? song.*field : 1.0;
+        };
+        auto worse = [](const pair<double, size_t>& a, const pair<double, size_t>& b) {
+            return a.first != b.first ? a.first < b.first : a.second > b.second;
+        };
+        vector<pair<double, size_t>> heads;
+        for (size_t p : active) {
+            if (claimHead(p)) heads.push_back({headPriority(p), p});
+        }
+        make_heap(heads.begin(), heads.end(), worse);
+
+        while (!heads.empty()) {
+            pop_heap(heads.begin(), heads.end(), worse);
+            size_t p = heads.back().second;
+            heads.pop_back();
+            if (!emit(p)) return emitted;
+            if (claimHead(p)) {
+                heads.push_back({headPriority(p), p});
+                push_heap(heads.begin(), heads.end(), worse);
+            }
+        }
+        return emitted;
+    }
+
+    vector<Song> mergePlaylists(const vector<vector<Song>>& playlists, const string& criteria = "rating",
+                                bool roundRobin = false) const {
+        vector<const vector<Song>*> sources;
+        size_t total = 0;
+        for (const vector<Song>& playlist : playlists) {
+            sources.push_back(&playlist);
+            total += playlist.size();
+        }
+
+        vector<Song> merged;
+        merged.reserve(total);
+        mergePlaylists(sources, [&merged](const Song& song) {
+            merged.push_back(song);
+            return true;
+        }, criteria, roundRobin);
+        return merged;
+    }
+
+    vector<Song> mergePlaylists(const vector<Song>& playlist1, const vector<Song>& playlist2) {
+        vector<Song> merged;
+        merged.reserve(playlist1.size() + playlist2.size());
+        mergePlaylists({&playlist1, &playlist2}, [&merged](const Song& song) {
+            merged.push_back(song);
+            return true;
+        });
+        return merged;
+    }
+
+    vector<Song> generatePlaylist(int tripDuration, const string& mood, const string& genre) {
+        double targetSeconds = tripDuration * 60.0;
+        vector<Song> playlist;
+        if (targetSeconds > 0) {
+            size_t limit = static_cast<size_t>(targetSeconds / 60) + FIT_CANDIDATES;
+            for (uint32_t slot : fitDuration(fitCandidates(mood, genre, limit), targetSeconds)) {
+                playlist.push_back(heapSongs[slot]);
+            }
+            playlist = optimizePlaylistOrder(playlist);
+        }
+        currentPlaylist = playlist;
+        return playlist;
+    }
+
+    vector<Song> generatePlaylist(ItineraryTree& itinerary, const string& mood, const string& genre) {
+        return generatePlaylist(static_cast<int>(itinerary.getTotalDuration() * 60 + 0.5), mood, genre);
+    }
+
+    vector<Song> generatePlaylist(Graph& graph, const string& source, const string& destination,
+                                  const string& mood, const string& genre) {
+        auto route = graph.findFastestPath(source, destination);
+        if (route.path.empty() || route.path.front() != source || route.totalWeight == numeric_limits<double>::infinity()) {
+            currentPlaylist.clear();
+            return currentPlaylist;
+        }
+        return generatePlaylist(static_cast<int>(route.totalWeight * 60 + 0.5), mood, genre);
+    }
+
+    static double playlistSeconds(const vector<Song>& playlist) {
+        double total = 0;
+        for (const Song& song : playlist) total += song.duration > 0 ? song.duration : DEFAULT_SONG_SECONDS;
+        return total;
+    }
+
+    vector<Song> optimizePlaylistOrder(const vector<Song>& songs, int budgetMilliseconds = ORDER_BUDGET_MILLISECONDS) {
+        size_t n = songs.size();
+        if (n < 3) return songs;
+
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(budgetMilliseconds);
+        auto expired = [&deadline]() { return chrono::steady_clock::now() >= deadline; };
+        TransitionFeatures features = transitionFeatures(songs);
+        bool cached = n <= TRANSITION_MATRIX_LIMIT;
+        vector<float> matrix(cached ? n * n : 0);
+        for (size_t i = 0; cached && i < n; i++) {
+            transitionRow(features, i, &matrix[i * n]);
+            if (i + 1 < n && expired()) {
+                cached = false;
+                vector<float>().swap(matrix);
+            }
+        }
+        auto cost = [&](long a, long b) -> float {
+            if (a < 0 || b < 0) return 0;
+            return cached ? matrix[a * n + b] : transitionCost(features, a, b);
+        };
+        auto repeats = [&](long a, long b) -> int {
+            return a >= 0 && b >= 0 && features.artist[a] == features.artist[b] ? 1 : 0;
+        };
+
+        vector<long> order(1, 0);
+        vector<char> placed(n, 0);
+        vector<float> row(n);
+        placed[0] = 1;
+        for (size_t step = 1; step < n && !expired(); step++) {
+            long from = order.back();
+            const float* distances = &row[0];
+            if (cached) distances = &matrix[from * n];
+            else transitionRow(features, from, &row[0]);
+            long nearest = -1;
+            for (size_t j = 0; j < n; j++) {
+                if (placed[j]) continue;
+                long candidate = static_cast<long>(j);
+                if (nearest < 0 || repeats(from, candidate) < repeats(from, nearest) ||
+                    (repeats(from, candidate) == repeats(from, nearest) && distances[j] < distances[nearest])) {
+                    nearest = candidate;
+                }
+            }
+            placed[nearest] = 1;
+            order.push_back(nearest);
+        }
+        if (order.size() < n) {
+            unordered_map<int32_t, vector<long>> byArtist;
+            for (size_t j = 0; j < n; j++) {
+                if (!placed[j]) byArtist[features.artist[j]].push_back(static_cast<long>(j));
+            }
+            priority_queue<pair<size_t, int32_t>> largest;
+            for (const auto& group : byArtist) largest.push({group.second.size(), group.first});
+            int32_t lastArtist = features.artist[order.back()];
+            while (!largest.empty()) {
+                auto pick = largest.top();
+                largest.pop();
+                if (pick.second == lastArtist && !largest.empty()) {
+                    auto other = largest.top();
+                    largest.pop();
+                    largest.push(pick);
+                    pick = other;
+                }
+                vector<long>& group = byArtist[pick.second];
+                order.push_back(group.back());
+                group.pop_back();
+                lastArtist = pick.second;
+                if (--pick.first > 0) largest.push(pick);
+            }
+        }
+
+        const float epsilon = 1e-4f;
+        long count = static_cast<long>(n);
+        auto at = [&](long i) { return i < 0 || i >= count ? -1L : order[i]; };
+        auto better = [epsilon](int repeatDelta, float delta) {
+            return repeatDelta < 0 || (repeatDelta == 0 && delta < -epsilon);
+        };
+        bool improved = true;
+        while (improved && !expired()) {
+            improved = false;
+            for (long i = -1; i + 2 < count; i++) {
+                for (long j = i + 2; j < count; j++) {
+                    int repeatDelta = repeats(at(i), at(j)) + repeats(at(i + 1), at(j + 1)) - repeats(at(i), at(i + 1)) -
+                                      repeats(at(j), at(j + 1));
+                    float delta = cost(at(i), at(j)) + cost(at(i + 1), at(j + 1)) - cost(at(i), at(i + 1)) -
+                                  cost(at(j), at(j + 1));
+                    if (better(repeatDelta, delta)) {
+                        reverse(order.begin() + i + 1, order.begin() + j + 1);
+                        improved = true;
+                    }
+                }
+                if (expired()) break;
+            }
+
+            for (long length = 1; length <= 3 && !expired(); length++) {
+                for (long start = 0; start + length <= count && !expired(); start++) {
+                    long end = start + length - 1;
+                    long first = order[start], last = order[end];
+                    long previous = at(start - 1), next = at(end + 1);
+                    int removedRepeats = repeats(previous, first) + repeats(last, next) - repeats(previous, next);
+                    float removed = cost(previous, first) + cost(last, next) - cost(previous, next);
+
+                    for (long p = -1; p < count; p++) {
+                        if (p >= start - 1 && p <= end) continue;
+                        long x = at(p), y = at(p + 1);
+                        int forwardRepeats = repeats(x, first) + repeats(last, y) - repeats(x, y) - removedRepeats;
+                        int backwardRepeats = repeats(x, last) + repeats(first, y) - repeats(x, y) - removedRepeats;
+                        float forward = cost(x, first) + cost(last, y) - cost(x, y) - removed;
+                        float backward = cost(x, last) + cost(first, y) - cost(x, y) - removed;
+                        bool reversed = backwardRepeats < forwardRepeats ||
+                                        (backwardRepeats == forwardRepeats && backward < forward);
+                        if (!better(reversed ? backwardRepeats : forwardRepeats, reversed ? backward : forward)) continue;
+
+                        vector<long> segment(order.begin() + start, order.begin() + end + 1);
+                        if (reversed) reverse(segment.begin(), segment.end());
+                        order.erase(order.begin() + start, order.begin() + end + 1);
+                        long insertAt = p < start ? p + 1 : p + 1 - length;
+                        order.insert(order.begin() + insertAt, segment.begin(), segment.end());
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        vector<Song> ordered;
+        ordered.reserve(n);
+        for (long index : order) ordered.push_back(songs[index]);
+        return ordered;
+    }
+
+    void addToPlaylist(const Song& song) {
+        currentPlaylist.push_back(song);
+    }
+
+    bool removeFromPlaylist(const string& songId) {
+        for (auto it = currentPlaylist.begin(); it != currentPlaylist.end(); ++it) {
+            if (it->name == songId) {
+                currentPlaylist.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    vector<Song> shufflePlaylist() {
+        vector<Song> shuffled = currentPlaylist;
+        random_shuffle(shuffled.begin(), shuffled.end());
+        return shuffled;
+    }
+
+    vector<Song> getCurrentPlaylist() {
+        return currentPlaylist;
+    }
+};
+
+void displayMainMenu() {
+    cout << "\n========================================================\n";
+    cout << "       TRAVEL PLANNING & MUSIC SYSTEM                   \n";
+    cout << "========================================================\n";
+    cout << "1.  Route Planning (Graph)\n";
+    cout << "2.  Itinerary Management (Tree)\n";
+    cout << "3.  Activity Search & Sort\n";
+    cout << "4.  Music Library (Trie)\n";
+    cout << "5.  Song Frequency Tracking\n";
+    cout << "6.  Playlist Generation (Heap)\n";
+    cout << "0.  Exit\n";
+    cout << "--------------------------------------------------------\n";
+    cout << "Enter your choice: ";
+}
+
+void routePlanningMenu(Graph& graph) {
+    int choice;
+    do {
+        cout << "\n--- ROUTE PLANNING ---\n";
+        cout << "1. Add City\n";
+        cout << "2. Add Route\n";
+        cout << "3. Find Shortest Path\n";
+        cout << "4. Find Cheapest Path\n";
+        cout << "5. Find Fastest Path\n";
+        cout << "6. Find Path with Stops\n";
+        cout << "7. Get Alternative Paths\n";
+        cout << "8. View All Cities\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1) {
+            string city;
+            cout << "Enter city name: ";
+            cin.ignore();
+            getline(cin, city);
+            if (graph.addCity(city)) {
+                cout << "✓ City added successfully!\n";
+            } else {
+                cout << "✗ City already exists!\n";
+            }
+        }
+        else if (choice == 2) {
+            string city1, city2;
+            double distance, cost, time;
+            cout << "Enter first city: ";
+            cin.ignore();
+            getline(cin, city1);
+            cout << "Enter second city: ";
+            getline(cin, city2);
+            cout << "Enter distance (km): ";
+            cin >> distance;
+            cout << "Enter cost ($): ";
+            cin >> cost;
+            cout << "Enter time (hours): ";
+            cin >> time;
+            graph.addRoute(city1, city2, distance, cost, time);
+            cout << "✓ Route added successfully!\n";
+        }
+        else if (choice == 3) {
+            string source, dest;
+            cout << "Enter source city: ";
+            cin.ignore();
+            getline(cin, source);
+            cout << "Enter destination city: ";
+            getline(cin, dest);
+            auto result = graph.findShortestPath(source, dest);
+            cout << "\n--- Shortest Path ---\n";
+            cout << "Path: ";
+            for (size_t i = 0; i < result.path.size(); i++) {
+                cout << result.path[i];
+                if (i < result.path.size() - 1) cout << " → ";
+            }
+            cout << "\nTotal Distance: " << result.totalWeight << " km\n";
+        }
+        else if (choice == 4) {
+            string source, dest;
+            cout << "Enter source city: ";
+            cin.ignore();
+            getline(cin, source);
+            cout << "Enter destination city: ";
+            getline(cin, dest);
+            auto result = graph.findCheapestPath(source, dest);
+            cout << "\n--- Cheapest Path ---\n";
+            cout << "Path: ";
+            for (size_t i = 0; i < result.path.size(); i++) {
+                cout << result.path[i];
+                if (i < result.path.size() - 1) cout << " → ";
+            }
+            cout << "\nTotal Cost: $" << result.totalWeight << "\n";
+        }
+        else if (choice == 5) {
+            string source, dest;
+            cout << "Enter source city: ";
+            cin.ignore();
+            getline(cin, source);
+            cout << "Enter destination city: ";
+            getline(cin, dest);
+            auto result = graph.findFastestPath(source, dest);
+            cout << "\n--- Fastest Path ---\n";
+            cout << "Path: ";
+            for (size_t i = 0; i < result.path.size(); i++) {
+                cout << result.path[i];
+                if (i < result.path.size() - 1) cout << " → ";
+            }
+            cout << "\nTotal Time: " << result.totalWeight << " hours\n";
+        }
+        else if (choice == 6) {
+            string source, dest;
+            int numStops;
+            cout << "Enter source city: ";
+            cin.ignore();
+            getline(cin, source);
+            cout << "Enter destination city: ";
+            getline(cin, dest);
+            cout << "Number of stops: ";
+            cin >> numStops;
+            vector<string> stops;
+            cin.ignore();
+            for (int i = 0; i < numStops; i++) {
+                string stop;
+                cout << "Stop " << (i + 1) << ": ";
+                getline(cin, stop);
+                stops.push_back(stop);
+            }
+            auto result = graph.findPathWithStops(source, dest, stops);
+            cout << "\n--- Path with Stops ---\n";
+            cout << "Path: ";
+            for (size_t i = 0; i < result.path.size(); i++) {
+                cout << result.path[i];
+                if (i < result.path.size() - 1) cout << " → ";
+            }
+            cout << "\nTotal Distance: " << result.totalWeight << " km\n";
+        }
+        else if (choice == 7) {
+            string source, dest;
+            cout << "Enter source city: ";
+            cin.ignore();
+            getline(cin, source);
+            cout << "Enter destination city: ";
+            getline(cin, dest);
+            auto paths = graph.getAlternativePaths(source, dest, 3);
+            cout << "\n--- Alternative Paths ---\n";
+            for (size_t i = 0; i < paths.size(); i++) {
+                cout << "Path " << (i + 1) << ": ";
+                for (size_t j = 0; j < paths[i].path.size(); j++) {
+                    cout << paths[i].path[j];
+                    if (j < paths[i].path.size() - 1) cout << " → ";
+                }
+                cout << " (Distance: " << paths[i].totalWeight << " km)\n";
+            }
+        }
+        else if (choice == 8) {
+            auto cities = graph.getAllCities();
+            cout << "\n--- All Cities ---\n";
+            for (size_t i = 0; i < cities.size(); i++) {
+                cout << (i + 1) << ". " << cities[i] << "\n";
+            }
+        }
+    } while (choice != 0);
+}
+
+void itineraryMenu(ItineraryTree& itinerary, ItineraryBuilder& builder) {
+    int choice;
+    do {
+        cout << "\n--- ITINERARY MANAGEMENT ---\n";
+        cout << "1. Create Itinerary\n";
+        cout << "2. Add Day\n";
+        cout << "3. Add Activity\n";
+        cout << "4. Remove Activity\n";
+        cout << "5. Move Activity\n";
+        cout << "6. Display Itinerary\n";
+        cout << "7. Get Day Schedule\n";
+        cout << "8. View Total Cost & Duration\n";
+        cout << "9. Check Schedule Feasibility\n";
+        cout << "10. Auto-build Itinerary\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1) {
+            string name, start, end;
+            cout << "Enter trip name: ";
+            cin.ignore();
+            getline(cin, name);
+            cout << "Start date (YYYY-MM-DD): ";
+            getline(cin, start);
+            cout << "End date (YYYY-MM-DD): ";
+            getline(cin, end);
+            itinerary.createItinerary(name, start, end);
+            cout << "✓ Itinerary created!\n";
+        }
+        else if (choice == 2) {
+            int dayNum;
+            string date;
+            cout << "Enter day number: ";
+            cin >> dayNum;
+            cout << "Enter date (YYYY-MM-DD): ";
+            cin.ignore();
+            getline(cin, date);
+            itinerary.addDay(dayNum, date);
+            cout << "✓ Day added!\n";
+        }
+        else if (choice == 3) {
+            int dayNum;
+            string name, duration, cost, startTime, location;
+            cout << "Enter day number: ";
+            cin >> dayNum;
+            cin.ignore();
+            cout << "Activity name: ";
+            getline(cin, name);
+            cout << "Duration (hours): ";
+            getline(cin, duration);
+            cout << "Cost ($): ";
+            getline(cin, cost);
+            cout << "Start time (HH:MM, blank if flexible): ";
+            getline(cin, startTime);
+            cout << "Location (blank if none): ";
+            getline(cin, location);
+
+            double parsed;
+            if (!parseClockTime(duration, parsed) || (!startTime.empty() && !parseClockTime(startTime, parsed))) {
+                cout << "✗ Invalid duration or start time!\n";
+                continue;
+            }
+
+            map<string, string> activity = {
+                {"id", "act_" + to_string(rand() % 10000)},
+                {"name", name},
+                {"duration", duration},
+                {"cost", cost}
+            };
+            if (!startTime.empty()) activity["start_time"] = startTime;
+            if (!location.empty()) activity["location"] = location;
+            itinerary.addActivity(dayNum, activity);
+            cout << "✓ Activity added!\n";
+            for (const auto& issue : itinerary.checkSchedule(dayNum)) {
+                cout << "⚠ " << issue.detail << "\n";
+            }
+        }
+        else if (choice == 4) {
+            int dayNum;
+            string actId;
+            cout << "Enter day number: ";
+            cin >> dayNum;
+            cout << "Enter activity ID: ";
+            cin >> actId;
+            if (itinerary.removeActivity(dayNum, actId)) {
+                cout << "✓ Activity removed!\n";
+            } else {
+                cout << "✗ Activity not found!\n";
+            }
+        }
+        else if (choice == 5) {
+            int fromDay, toDay;
+            string actId;
+            cout << "From day: ";
+            cin >> fromDay;
+            cout << "To day: ";
+            cin >> toDay;
+            cout << "Activity ID: ";
+            cin >> actId;
+            if (itinerary.moveActivity(fromDay, toDay, actId)) {
+                cout << "✓ Activity moved!\n";
+            } else {
+                cout << "✗ Failed to move activity!\n";
+            }
+        }
+        else if (choice == 6) {
+            cout << itinerary.displayItinerary();
+        }
+        else if (choice == 7) {
+            int dayNum;
+            cout << "Enter day number: ";
+            cin >> dayNum;
+            auto schedule = itinerary.getDaySchedule(dayNum);
+            cout << "\n--- Day " << dayNum << " Schedule ---\n";
+            for (size_t i = 0; i < schedule.size(); i++) {
+                cout << (i + 1) << ". " << schedule[i]["name"] << "\n";
+            }
+        }
+        else if (choice == 8) {
+            cout << "\n--- Trip Summary ---\n";
+            cout << "Total Duration: " << itinerary.getTotalDuration() << " hours\n";
+            cout << "Total Cost: $" << itinerary.getTotalCost() << "\n";
+        }
+        else if (choice == 9) {
+            int dayNum;
+            cout << "Enter day number: ";
+            cin >> dayNum;
+            auto issues = itinerary.checkSchedule(dayNum);
+            cout << "\n--- Day " << dayNum << " Feasibility ---\n";
+            if (issues.empty()) {
+                cout << "✓ Day " << dayNum << " fits!\n";
+            }
+            for (size_t i = 0; i < issues.size(); i++) {
+                cout << (i + 1) << ". [" << issues[i].type << "] " << issues[i].detail << "\n";
+            }
+        }
+        else if (choice == 10) {
+            int days, numCities;
+            double dailyHours, budget;
+            vector<string> cities;
+            cout << "Number of cities: ";
+            cin >> numCities;
+            cin.ignore();
+            for (int i = 0; i < numCities; i++) {
+                string city;
+                cout << "City " << (i + 1) << ": ";
+                getline(cin, city);
+                cities.push_back(city);
+            }
+            cout << "Number of days: ";
+            cin >> days;
+            cout << "Hours per day: ";
+            cin >> dailyHours;
+            cout << "Total budget ($): ";
+            cin >> budget;
+
+            auto plan = builder.buildItinerary(itinerary, cities, days, dailyHours, budget);
+            cout << "✓ Itinerary built! Total rating: " << plan.totalRating
+                 << " | Total cost: $" << plan.totalCost << "\n";
+            cout << itinerary.displayItinerary();
+        }
+    } while (choice != 0);
+}
+
+void activityMenu(ActivityManager& activityMgr) {
+    int choice;
+    do {
+        cout << "\n--- ACTIVITY MANAGEMENT ---\n";
+        cout << "1. Add Activity\n";
+        cout << "2. View All Activities (by City)\n";
+        cout << "3. Sort by Cost\n";
+        cout << "4. Sort by Rating\n";
+        cout << "5. Sort by Duration\n";
+        cout << "6. Filter Activities\n";
+        cout << "7. Search by Name\n";
+        cout << "8. Search by Category\n";
+        cout << "9. Activities Near Me\n";
+        cout << "10. Remove Activity\n";
+        cout << "11. Import Activities (CSV/JSON)\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1) {
+            string name, location, category;
+            double cost, rating, duration;
+            cout << "Activity name: ";
+            cin.ignore();
+            getline(cin, name);
+            cout << "Location: ";
+            getline(cin, location);
+            cout << "Category: ";
+            getline(cin, category);
+            cout << "Cost ($): ";
+            cin >> cost;
+            cout << "Rating (0-5): ";
+            cin >> rating;
+            cout << "Duration (hours): ";
+            cin >> duration;
+
+            if (activityMgr.addActivityToDB(name, location, category, cost, rating, duration).id.empty()) {
+                cout << "✗ Cost, rating and duration must be finite numbers.\n";
+            } else {
+                cout << "✓ Activity added!\n";
+            }
+        }
+        else if (choice == 2) {
+            string city;
+            cout << "Enter city: ";
+            cin.ignore();
+            getline(cin, city);
+            ActivitySpan activities = activityMgr.getCityActivities(city);
+            cout << "\n--- Activities in " << city << " ---\n";
+            for (size_t i = 0; i < activities.size(); i++) {
+                cout << (i + 1) << ". " << activities[i].name
+                     << " [" << activities[i].id << "]"
+                     << " | $" << activities[i].cost
+                     << " | ⭐" << activities[i].rating << "\n";
+            }
+        }
+        else if (choice == 3) {
+            string city, order;
+            cout << "Enter city: ";
+            cin.ignore();
+            getline(cin, city);
+            cout << "Order (asc/desc): ";
+            cin >> order;
+            auto activities = activityMgr.getAllActivities(city);
+            activities = activityMgr.sortByCost(activities, order);
+            cout << "\n--- Sorted by Cost ---\n";
+            for (size_t i = 0; i < activities.size(); i++) {
+                cout << (i + 1) << ". " << activities[i].name
+                     << " | $" << activities[i].cost << "\n";
+            }
+        }
+        else if (choice == 4) {
+            string city;
+            cout << "Enter city: ";
+            cin.ignore();
+            getline(cin, city);
+            ActivityQuery query;
+            query.location = city;
+            ActivityCursor cursor;
+            size_t shown = 0;
+            string more = "y";
+            cout << "\n--- Sorted by Rating ---\n";
+            while (more == "y") {
+                auto page = activityMgr.topActivities(query, ActivityScoreWeights(), 20, cursor);
+                for (const auto& ranked : page.results) {
+                    const Activity& a = activityMgr.activityAt(ranked.second);
+                    cout << (++shown) << ". " << a.name << " | ⭐" << a.rating << "\n";
+                }
+                if (!page.hasMore) break;
+                cursor = page.next;
+                cout << "Show more? (y/n): ";
+                cin >> more;
+            }
+        }
+        else if (choice == 6) {
+            string city;
+            double maxCost, minRating, maxDuration;
+            cout << "Enter city: ";
+            cin.ignore();
+            getline(cin, city);
+            cout << "Max cost ($): ";
+            cin >> maxCost;
+            cout << "Min rating (0-5): ";
+            cin >> minRating;
+            cout << "Max duration (hours): ";
+            cin >> maxDuration;
+
+            ActivityQuery query;
+            query.location = city;
+            query.maxCost = maxCost;
+            query.minRating = minRating;
+            query.maxDuration = maxDuration;
+
+            auto rows = activityMgr.queryRows(query);
+            cout << "\n--- Filtered Activities ---\n";
+            for (size_t i = 0; i < rows.size(); i++) {
+                const Activity& a = activityMgr.activityAt(rows[i]);
+                cout << (i + 1) << ". " << a.name
+                     << " | $" << a.cost
+                     << " | ⭐" << a.rating
+                     << " | " << a.duration << "h\n";
+            }
+        }
+        else if (choice == 7) {
+            string text;
+            cout << "Search for: ";
+            cin.ignore();
+            getline(cin, text);
+            auto matches = activityMgr.searchActivities(text);
+            cout << "\n--- Search Results ---\n";
+            if (matches.empty()) cout << "No matching activities\n";
+            for (size_t i = 0; i < matches.size(); i++) {
+                const Activity& a = activityMgr.activityAt(matches[i].second);
+                cout << (i + 1) << ". " << a.name << " (" << a.location << ", " << a.category << ")"
+                     << " | $" << a.cost << " | ⭐" << a.rating << "\n";
+            }
+        }
+        else if (choice == 8) {
+            string category;
+            cout << "Enter category: ";
+            cin.ignore();
+            getline(cin, category);
+            auto activities = activityMgr.getActivityByCategory(category);
+            cout << "\n--- " << category << " Activities ---\n";
+            for (size_t i = 0; i < activities.size(); i++) {
+                cout << (i + 1) << ". " << activities[i].name
+                     << " (" << activities[i].location << ")"
+                     << " | $" << activities[i].cost
+                     << " | ⭐" << activities[i].rating << "\n";
+            }
+        }
+        else if (choice == 9) {
+            double latitude, longitude;
+            int k;
+            cout << "Your latitude: ";
+            cin >> latitude;
+            cout << "Your longitude: ";
+            cin >> longitude;
+            cout << "How many results: ";
+            cin >> k;
+            auto nearest = activityMgr.nearestActivities(latitude, longitude, max(k, 0));
+            cout << "\n--- Nearest Activities ---\n";
+            for (size_t i = 0; i < nearest.size(); i++) {
+                const Activity& a = activityMgr.activityAt(nearest[i].second);
+                cout << (i + 1) << ". " << a.name << " (" << a.location << ")"
+                     << " | " << formatNumber(nearest[i].first) << " km\n";
+            }
+        }
+        else if (choice == 10) {
+            string id;
+            cout << "Enter activity ID: ";
+            cin >> id;
+            if (activityMgr.removeActivity(id)) {
+                cout << "✓ Activity removed!\n";
+            } else {
+                cout << "✗ Activity not found!\n";
+            }
+        }
+        else if (choice == 11) {
+            string path;
+            cout << "File path (.csv or .jsonl): ";
+            cin.ignore();
+            getline(cin, path);
+            ImportStats stats;
+            if (!activityMgr.importActivities(path, stats)) {
+                cout << "✗ Could not read " << path << "!\n";
+                continue;
+            }
+            cout << "✓ Imported " << stats.rowsImported << " activities ("
+                 << stats.rowsRejected << " rejected) in " << stats.seconds << "s | "
+                 << static_cast<long long>(stats.rowsPerSecond) << " rows/s\n";
+        }
+    } while (choice != 0);
+}
+
+void musicLibraryMenu(MusicTrie& musicTrie) {
+    int choice;
+    do {
+        cout << "\n--- MUSIC LIBRARY ---\n";
+        cout << "1. Add Song\n";
+        cout << "2. Search by Prefix\n";
+        cout << "3. Autocomplete\n";
+        cout << "4. Search by Artist\n";
+        cout << "5. View All Songs\n";
+        cout << "6. Delete Song\n";
+        cout << "7. Benchmark Library Trie\n";
+        cout << "8. Fuzzy Search\n";
+        cout << "9. Search by Genre\n";
+        cout << "10. Search by Minimum Rating\n";
+        cout << "11. Save Library Image\n";
+        cout << "12. Load Library Image\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1) {
+            string name, artist, genre, rating, duration, mood, tempo, key, energy;
+            cout << "Song name: ";
+            cin.ignore();
+            getline(cin, name);
+            cout << "Artist: ";
+            getline(cin, artist);
+            cout << "Genre: ";
+            getline(cin, genre);
+            cout << "Rating (0-5): ";
+            getline(cin, rating);
+            cout << "Duration (seconds or m:ss, blank if unknown): ";
+            getline(cin, duration);
+            cout << "Mood (blank if unknown): ";
+            getline(cin, mood);
+            cout << "Tempo in BPM (blank if unknown): ";
+            getline(cin, tempo);
+            cout << "Key, e.g. C, F#m (blank if unknown): ";
+            getline(cin, key);
+            cout << "Energy (0-1, blank if unknown): ";
+            getline(cin, energy);
+
+            double seconds;
+            if (!duration.empty() && !parseSongDuration(duration, seconds)) {
+                cout << "✗ Duration must be a number of seconds or m:ss!\n";
+                continue;
+            }
+
+            map<string, string> metadata = {{"genre", genre}, {"rating", rating}};
+            if (!duration.empty()) metadata["duration"] = duration;
+            if (!mood.empty()) metadata["mood"] = mood;
+            if (!tempo.empty()) metadata["tempo"] = tempo;
+            if (!key.empty()) metadata["key"] = key;
+            if (!energy.empty()) metadata["energy"] = energy;
+            musicTrie.insertSong(name, artist, metadata);
+            cout << "✓ Song added!\n";
+        }
+        else if (choice == 2) {
+            string prefix;
+            cout << "Enter prefix: ";
+            cin.ignore();
+            getline(cin, prefix);
+            auto songs = musicTrie.searchPrefix(prefix);
+            cout << "\n--- Search Results ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                cout << (i + 1) << ". " << songs[i].name
+                     << " by " << songs[i].artist << "\n";
+            }
+        }
+        else if (choice == 3) {
+            string prefix;
+            int limit;
+            cout << "Enter prefix: ";
+            cin.ignore();
+            getline(cin, prefix);
+            cout << "Number of suggestions: ";
+            cin >> limit;
+            auto songs = musicTrie.autoComplete(prefix, limit);
+            cout << "\n--- Autocomplete Suggestions ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                cout << (i + 1) << ". " << songs[i]->name
+                     << " by " << songs[i]->artist << "\n";
+            }
+        }
+        else if (choice == 4) {
+            string artist;
+            cout << "Enter artist name: ";
+            cin.ignore();
+            getline(cin, artist);
+            auto songs = musicTrie.searchByArtist(artist);
+            if (songs.empty()) songs = musicTrie.searchByArtistPrefix(artist);
+            cout << "\n--- Songs by " << artist << " ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                cout << (i + 1) << ". " << songs[i]->name << " by " << songs[i]->artist << "\n";
+            }
+        }
+        else if (choice == 5) {
+            auto songs = musicTrie.getAllSongs();
+            cout << "\n--- All Songs ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                cout << (i + 1) << ". " << songs[i].name
+                     << " by " << songs[i].artist << "\n";
+            }
+        }
+        else if (choice == 6) {
+            string name, artist;
+            cout << "Enter song name: ";
+            cin.ignore();
+            getline(cin, name);
+            cout << "Artist (leave blank for all versions): ";
+            getline(cin, artist);
+            if (musicTrie.deleteSong(name, artist)) {
+                cout << "✓ Song deleted!\n";
+            } else {
+                cout << "✗ Song not found!\n";
+            }
+        }
+        else if (choice == 7) {
+            size_t count;
+            cout << "Number of songs to benchmark: ";
+            cin >> count;
+            cout << "\n--- Trie Benchmark ---\n" << benchmarkMusicTrie(max<size_t>(count, 1));
+        }
+        else if (choice == 8) {
+            string query;
+            int distance;
+            cout << "Enter song name (typos allowed): ";
+            cin.ignore();
+            getline(cin, query);
+            cout << "Max typos (1-2): ";
+            cin >> distance;
+            size_t visited = 0;
+            auto matches = musicTrie.fuzzySearch(query, distance, 10, &visited);
+            cout << "\n--- Fuzzy Matches ---\n";
+            for (size_t i = 0; i < matches.size(); i++) {
+                cout << (i + 1) << ". " << matches[i].song->name << " by " << matches[i].song->artist
+                     << " (" << matches[i].distance << " edits)\n";
+            }
+            cout << "Visited " << visited << " of " << musicTrie.nodeCount() << " nodes\n";
+        }
+        else if (choice == 9) {
+            string genre;
+            cout << "Enter genre: ";
+            cin.ignore();
+            getline(cin, genre);
+            auto songs = musicTrie.searchByGenre(genre);
+            cout << "\n--- " << genre << " Songs ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                cout << (i + 1) << ". " << songs[i]->name << " by " << songs[i]->artist << "\n";
+            }
+        }
+        else if (choice == 10) {
+            double minRating;
+            cout << "Minimum rating: ";
+            cin >> minRating;
+            auto songs = musicTrie.searchByRating(minRating);
+            cout << "\n--- Songs Rated " << minRating << "+ ---\n";
+            for (size_t i = 0; i < songs.size(); i++) {
+                auto rating = songs[i]->metadata.find("rating");
+                cout << (i + 1) << ". " << songs[i]->name << " by " << songs[i]->artist
+                     << " (" << (rating != songs[i]->metadata.end() ? rating->second : "unrated") << ")\n";
+            }
+        }
+        else if (choice == 11 || choice == 12) {
+            string path;
+            cout << "Image file path: ";
+            cin.ignore();
+            getline(cin, path);
+            bool ok = choice == 11 ? musicTrie.saveImage(path) : musicTrie.loadImage(path);
+            if (ok) {
+                cout << "✓ " << (choice == 11 ? "Saved " : "Loaded ") << musicTrie.size() << " songs\n";
+            } else {
+                cout << "✗ Could not " << (choice == 11 ? "write" : "read") << " library image!\n";
+            }
+        }
+    } while (choice != 0);
+}
+
+void frequencyMenu(FrequencyTracker& tracker, MusicTrie& musicTrie) {
+    int choice;
+    do {
+        cout << "\n--- FREQUENCY TRACKING ---\n";
+        cout << "1. Play Song (Increment Count)\n";
+        cout << "2. View Play Count\n";
+        cout << "3. Get Most Played Songs\n";
+        cout << "4. Reset All Frequencies\n";
+        cout << "5. Switch to Approximate Counting\n";
+        cout << "6. Most Played Recently\n";
+        cout << "7. Trending Songs\n";
+        cout << "8. Keep Play History on Disk\n";
+        cout << "9. Snapshot Play History\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1) {
+            string songId;
+            cout << "Enter song ID/name: ";
+            cin.ignore();
+            getline(cin, songId);
+            tracker.incrementPlayCount(songId);
+            musicTrie.recordPlay(songId);
+            cout << "✓ Play count incremented!\n";
+        }
+        else if (choice == 2) {
+            string songId;
+            cout << "Enter song ID/name: ";
+            cin.ignore();
+            getline(cin, songId);
+            cout << "Play count: " << tracker.getPlayCount(songId);
+            if (const CountMinSketch* counts = tracker.approximateCounts()) {
+                cout << " (may overcount by up to " << formatNumber(counts->errorBound()) << " with "
+                     << formatNumber(counts->confidence() * 100) << "% confidence)";
+            }
+            cout << "\n";
+        }
+        else if (choice == 3) {
+            int k;
+            cout << "How many top songs: ";
+            cin >> k;
+            auto topSongs = tracker.getMostPlayed(k);
+            if (k > 0 && static_cast<size_t>(k) > tracker.approximateTopLimit()) {
+                cout << "Approximate counting keeps only the top " << tracker.approximateTopLimit() << " songs.\n";
+            }
+            cout << "\n--- Most Played Songs ---\n";
+            for (size_t i = 0; i < topSongs.size(); i++) {
+                cout << (i + 1) << ". " << topSongs[i].first
+                     << " (" << topSongs[i].second << " plays)\n";
+            }
+        }
+        else if (choice == 4) {
+            tracker.resetFrequencies();
+            musicTrie.resetPlays();
+            cout << "✓ All frequencies reset!\n";
+        }
+        else if (choice == 5) {
+            double epsilon, delta;
+            int topSongs;
+            cout << "Error as a fraction of total plays (e.g. 0.001): ";
+            cin >> epsilon;
+            cout << "Failure probability (e.g. 0.01): ";
+            cin >> delta;
+            cout << "Top songs to keep (e.g. 100): ";
+            cin >> topSongs;
+            if (!CountMinSketch::supportsErrorBounds(epsilon, delta)) {
+                cout << "✗ Values must be between 0 and 1, and an error that small would need too large a sketch!\n";
+                continue;
+            }
+            tracker.enableApproximateMode(epsilon, delta, static_cast<size_t>(max(topSongs, 0)));
+            if (const CountMinSketch* counts = tracker.approximateCounts()) {
+                cout << "✓ Approximate counting uses " << formatNumber(counts->memoryUsage() / 1024.0) << " KiB\n";
+            } else {
+                cout << "✗ Approximate counting is not available while play history is kept on disk!\n";
+            }
+        }
+        else if (choice == 6) {
+            string window;
+            int k;
+            cout << "Window (hour/day/week): ";
+            cin >> window;
+            cout << "How many top songs: ";
+            cin >> k;
+            auto topSongs = tracker.getMostPlayedInWindow(window, k);
+            cout << "\n--- Most Played This " << window << " ---\n";
+            for (size_t i = 0; i < topSongs.size(); i++) {
+                cout << (i + 1) << ". " << topSongs[i].first
+                     << " (" << topSongs[i].second << " plays)\n";
+            }
+        }
+        else if (choice == 7) {
+            int k;
+            cout << "How many trending songs: ";
+            cin >> k;
+            auto topSongs = tracker.getTrending(k);
+            cout << "\n--- Trending Songs ---\n";
+            for (size_t i = 0; i < topSongs.size(); i++) {
+                cout << (i + 1) << ". " << topSongs[i].first
+                     << " (score " << formatNumber(topSongs[i].second) << ")\n";
+            }
+        }
+        else if (choice == 8) {
+            string path;
+            cout << "History path prefix: ";
+            cin >> path;
+            if (tracker.enableDurability(path)) {
+                cout << "✓ Play history restored and logged to " << path << "\n";
+            } else {
+                cout << "✗ Could not open play history: snapshot or log segments are damaged or missing!\n";
+            }
+        }
+        else if (choice == 9) {
+            if (tracker.checkpoint()) {
+                cout << "✓ Play history snapshot written!\n";
+            } else {
+                cout << "✗ Play history is not being kept on disk!\n";
+            }
+        }
+    } while (choice != 0);
+}
+
+void playlistMenu(PlaylistHeap& playlistHeap, MusicTrie& musicTrie, ItineraryTree& itinerary, Graph& graph) {
+    int choice;
+    bool heapBuilt = false;
+    uint64_t heapRevision = 0;
+    do {
+        cout << "\n--- PLAYLIST GENERATION ---\n";
+        cout << "1. Generate Playlist\n";
+        cout << "2. View Current Playlist\n";
+        cout << "3. Add Song to Playlist\n";
+        cout << "4. Remove Song from Playlist\n";
+        cout << "5. Shuffle Playlist\n";
+        cout << "6. Playlist for Itinerary\n";
+        cout << "7. Playlist for Route\n";
+        cout << "0. Back\n";
+        cout << "Choice: ";
+        cin >> choice;
+
+        if (choice == 1 || choice == 6 || choice == 7) {
+            int duration = 0;
+            string mood, genre, source, destination;
+            if (choice == 1) {
+                cout << "Trip duration (minutes): ";
+                cin >> duration;
+            }
+            cin.ignore();
+            if (choice == 7) {
+                cout << "From city: ";
+                getline(cin, source);
+                cout << "To city: ";
+                getline(cin, destination);
+            }
+            cout << "Mood: ";
+            getline(cin, mood);
+            cout << "Genre: ";
+            getline(cin, genre);
+
+            if (!heapBuilt || heapRevision != musicTrie.getRevision()) {
+                playlistHeap.buildMaxHeap(musicTrie.getAllSongs(), "rating");
+                heapBuilt = true;
+                heapRevision = musicTrie.getRevision();
+            }
+            if (playlistHeap.countMatching(mood, genre) == 0) {
+                cout << "✗ No songs match that mood and genre!\n";
+                continue;
+            }
+
+            vector<Song> playlist;
+            if (choice == 1) playlist = playlistHeap.generatePlaylist(duration, mood, genre);
+            else if (choice == 6) playlist = playlistHeap.generatePlaylist(itinerary, mood, genre);
+            else playlist = playlistHeap.generatePlaylist(graph, source, destination, mood, genre);
+
+            cout << "\n✓ Playlist Generated! (" << formatClockTime(PlaylistHeap::playlistSeconds(playlist) / 3600)
+                 << " of music)\n";
+            for (size_t i = 0; i < playlist.size(); i++) {
+                cout << (i + 1) << ". " << playlist[i].name
+                     << " by " << playlist[i].artist << "\n";
+            }
+        }
+        else if (choice == 2) {
+            auto playlist = playlistHeap.getCurrentPlaylist();
+            cout << "\n--- Current Playlist ---\n";
+            for (size_t i = 0; i < playlist.size(); i++) {
+                cout << (i + 1) << ". " << playlist[i].name
+                     << " by " << playlist[i].artist << "\n";
+            }
+        }
+        else if (choice == 5) {
+            auto shuffled = playlistHeap.shufflePlaylist();
+            cout << "\n--- Shuffled Playlist ---\n";
+            for (size_t i = 0; i < shuffled.size(); i++) {
+                cout << (i + 1) << ". " << shuffled[i].name
+                     << " by " << shuffled[i].artist << "\n";
+            }
+        }
+    } while (choice != 0);
+}
+
+int main() {
+    srand(time(0));
+
+    Graph graph;
+    ItineraryTree itinerary;
+    ActivityManager activityMgr;
+    MusicTrie musicTrie;
+    FrequencyTracker tracker;
+    PlaylistHeap playlistHeap;
+    ScheduleChecker scheduleChecker(graph);
+    itinerary.attachScheduleChecker(&scheduleChecker);
+    ItineraryBuilder itineraryBuilder(activityMgr, scheduleChecker);
+
+    graph.addCity("New York");
+    graph.addCity("Boston");
+    graph.addCity("Philadelphia");
+    graph.addCity("Washington DC");
+    graph.addRoute("New York", "Boston", 215, 50, 4);
+    graph.addRoute("New York", "Philadelphia", 95, 30, 2);
+    graph.addRoute("Philadelphia", "Washington DC", 140, 35, 2.5);
+    graph.addRoute("Boston", "Philadelphia", 310, 65, 6);
+
+    activityMgr.setLocationCoordinates("New York", 40.7128, -74.0060);
+    activityMgr.setLocationCoordinates("Boston", 42.3601, -71.0589);
+    activityMgr.setLocationCoordinates("Philadelphia", 39.9526, -75.1652);
+    activityMgr.setLocationCoordinates("Washington DC", 38.9072, -77.0369);
+    activityMgr.addActivityToDB("Statue of Liberty", "New York", "Sightseeing", 25, 4.8, 3, 40.6892, -74.0445);
+    activityMgr.addActivityToDB("Central Park", "New York", "Nature", 0, 4.7, 2, 40.7829, -73.9654);
+    activityMgr.addActivityToDB("Broadway Show", "New York", "Entertainment", 150, 4.9, 3, 40.7590, -73.9845);
+
+    musicTrie.insertSong("Shape of You", "Ed Sheeran", {{"genre", "Pop"}, {"rating", "4.5"}});
+    musicTrie.insertSong("Bohemian Rhapsody", "Queen", {{"genre", "Rock"}, {"rating", "5.0"}});
+    musicTrie.insertSong("Blinding Lights", "The Weeknd", {{"genre", "Pop"}, {"rating", "4.7"}});
+
+    int choice;
+    do {
+        displayMainMenu();
+        cin >> choice;
+
+        switch (choice) {
+            case 1:
+                routePlanningMenu(graph);
+                break;
+            case 2:
+                itineraryMenu(itinerary, itineraryBuilder);
+                break;
+            case 3:
+                activityMenu(activityMgr);
+                break;
+            case 4:
+                musicLibraryMenu(musicTrie);
+                break;
+            case 5:
+                frequencyMenu(tracker, musicTrie);
+                break;
+            case 6:
+                playlistMenu(playlistHeap, musicTrie, itinerary, graph);
+                break;
+            case 0:
+                cout << "\n Thank you for using Travel Planning System! \n";
+                break;
+            default:
+                cout << "Invalid choice! Please try again.\n";
+        }
+    } while (choice != 0);
+
+    return 0;
+}
+
+